@@ -72,6 +72,10 @@ for I in "$@"; do
   if [[ $I == "doc" ]]; then
     GEN_DOC=1
   fi
+
+  if [[ $I == "bench" ]]; then
+    CMAKE_OPTIONS+="-DCXXLOG_BUILD_BENCHMARKS:BOOL=ON "
+  fi
 done
 
 if [[ -z $DEFAULT_BUILD_DIR ]]; then DEFAULT_BUILD_DIR=build; fi
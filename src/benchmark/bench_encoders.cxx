@@ -0,0 +1,82 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <ostream>
+#include <streambuf>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/transport.h>
+#include <cxxlog/transport/json.h>
+#include <cxxlog/transport/logfmt.h>
+#include <cxxlog/transport/msgpack.h>
+
+
+// ----------------------------------------------------------------------------
+// Helpers
+// ----------------------------------------------------------------------------
+namespace {
+  // Discards the output, counting the bytes written.
+  class NullBuffer: public std::streambuf {
+    public:
+      std::uint64_t bytes { 0 };
+
+    protected:
+      std::streamsize xsputn (const char *, std::streamsize n) override {
+        bytes += static_cast<std::uint64_t> (n);
+        return n;
+      }
+
+      int_type overflow (int_type c) override {
+        ++bytes;
+        return traits_type::not_eof (c);
+      }
+  };
+
+  constexpr int kRecords { 1'000'000 };
+
+  // Logs kRecords messages through a logger with a single transport of type T.
+  template<typename T>
+  void run (const char *name, bool withFields) {
+    NullBuffer buffer {};
+    std::ostream out { &buffer };
+
+    const cxxlog::Logger<T> logger { cxxlog::Severity::kVerbose };
+    logger.transport (T { out });
+
+    const auto start { std::chrono::steady_clock::now() };
+    for (int i = 0; i < kRecords; ++i) {
+      if (withFields)
+        logger.info ("request {} handled", i, cxxlog::kv ("status", 200), cxxlog::kv ("ms", 3.25), cxxlog::kv ("path", "/api/v1/items"));
+      else
+        logger.info ("request {} handled for user \"{}\"", i, "alice");
+    }
+    const std::chrono::duration<double> elapsed { std::chrono::steady_clock::now() - start };
+
+    std::printf (
+      "%-14s %-11s %8.1f ns/record %8.1f MB/s %6.1f bytes/record\n",
+      name, withFields ? "fields" : "message",
+      elapsed.count() * 1e9 / kRecords,
+      static_cast<double> (buffer.bytes) / elapsed.count() / 1e6,
+      static_cast<double> (buffer.bytes) / kRecords
+    );
+  }
+}
+
+// ----------------------------------------------------------------------------
+// main
+// ----------------------------------------------------------------------------
+int main () {
+  for (const bool withFields: { false, true }) {
+    run<cxxlog::transport::OutputStream> ("OutputStream", withFields);
+    run<cxxlog::transport::LogfmtStream> ("LogfmtStream", withFields);
+    run<cxxlog::transport::JsonStream> ("JsonStream", withFields);
+    run<cxxlog::transport::MsgPackStream> ("MsgPackStream", withFields);
+  }
+
+  return 0;
+}
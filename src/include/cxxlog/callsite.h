@@ -0,0 +1,313 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_CALLSITE_H__
+#define __CXX_LOGGER_CALLSITE_H__
+
+#include <atomic>
+#include <cinttypes>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog {
+
+/// @cond Doxygen_Suppress
+namespace detail {
+  /// Matches text against a pattern where `*` matches any run of characters and `?` any single
+  /// character.
+  inline bool glob (std::string_view pattern, std::string_view text) noexcept {
+    std::size_t p { 0 }, t { 0 };
+    std::size_t star { std::string_view::npos }, mark { 0 };
+
+    while (t < text.size()) {
+      if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+        ++p;
+        ++t;
+      }
+      else if (p < pattern.size() && pattern[p] == '*') {
+        star = p++;
+        mark = t;
+      }
+      else if (star != std::string_view::npos) {
+        p = star + 1;
+        t = ++mark;
+      }
+      else {
+        return false;
+      }
+    }
+
+    while (p < pattern.size() && pattern[p] == '*')
+      ++p;
+
+    return p == pattern.size();
+  }
+}
+/// @endcond
+
+/// @class Callsite
+/// @brief The registration record of a log statement written with the CXXLOG_LOG macros.
+///
+/// Every statement gets a static Callsite holding its file, line, function and format string,
+/// and a switch which outputs the statement whatever the Logger severity level threshold is.
+/// The switches are turned on and off with Callsites::enable() and Callsites::disable().
+class Callsite {
+  public:
+    /// @brief Constructor for the Callsite class, which registers it and applies the queries
+    /// given to Callsites so far. Callsites must have static storage duration.
+    Callsite (const char *file, unsigned line, const char *function, std::string_view format);
+
+    Callsite (const Callsite &) = delete;
+    Callsite & operator= (const Callsite &) = delete;
+
+    /// @brief Gets the source file of the statement.
+    std::string_view file () const noexcept { return _file; }
+
+    /// @brief Gets the line of the statement.
+    unsigned line () const noexcept { return _line; }
+
+    /// @brief Gets the function containing the statement.
+    std::string_view function () const noexcept { return _function; }
+
+    /// @brief Gets the format string of the statement.
+    std::string_view format () const noexcept { return _format; }
+
+    /// @brief Checks whether the statement was switched on.
+    /// @return `true` if the statement is output whatever the Logger level is.
+    bool enabled () const noexcept { return _enabled.load (std::memory_order_relaxed); }
+
+  private:
+    friend class Callsites;
+
+    // sites registered so far, most recent first; they are never unregistered
+    static std::atomic<Callsite *> & head () noexcept {
+      static std::atomic<Callsite *> h { nullptr };
+      return h;
+    }
+
+    const char *_file;
+    unsigned _line;
+    const char *_function;
+    std::string_view _format;
+    std::atomic<bool> _enabled { false };
+    Callsite *_next { nullptr };
+};
+
+/// @class Callsites
+/// @brief The control interface of the Callsite switches, in the spirit of the Linux kernel
+/// dynamic debug.
+///
+/// A single noisy statement can be switched on in a running process without raising the Logger
+/// severity level threshold or rebuilding. The statements are selected with a query of
+/// space-separated `key=value` terms, all of which must match:
+///
+/// | Key      | Matches                                                                    |
+/// |----------|----------------------------------------------------------------------------|
+/// | `file`   | the source file, or its base name, with `*` and `?` wildcards              |
+/// | `func`   | the function name, with `*` and `?` wildcards                              |
+/// | `line`   | the line, or a range of lines such as `10-20`                              |
+/// | `format` | the format strings which contain the value                                 |
+///
+/// @code
+///   CXXLOG_DEBUG (logger, "retrying {} in {} ms", host, delay);
+///   ...
+///   cxxlog::Callsites::enable ("file=net/*.cpp func=connect");
+/// @endcode
+///
+/// An empty query selects every statement. The queries are kept, in order, and applied to the
+/// statements which register later, on their first execution, so a statement can be switched on
+/// before it has ever run. reset() forgets them.
+class Callsites {
+  public:
+    /// @brief Switches on the statements matching a query.
+    /// @param query The query.
+    /// @return The number of matching statements.
+    /// @throws std::invalid_argument if the query is malformed.
+    static std::size_t enable (std::string_view query) { return set (query, true); }
+
+    /// @brief Switches off the statements matching a query.
+    /// @param query The query.
+    /// @return The number of matching statements.
+    /// @throws std::invalid_argument if the query is malformed.
+    static std::size_t disable (std::string_view query) { return set (query, false); }
+
+    /// @brief Forgets the queries given so far and switches off every statement.
+    static void reset () {
+      const std::lock_guard lock { mutex() };
+      queries().clear();
+
+      for (auto *site = Callsite::head().load (std::memory_order_acquire); site; site = site->_next)
+        site->_enabled.store (false, std::memory_order_relaxed);
+    }
+
+    /// @brief Calls a function with every registered statement, most recently registered first.
+    /// @param f The function, taking a `const Callsite &`.
+    template<typename F>
+    static void forEach (F &&f) {
+      for (const auto *site = Callsite::head().load (std::memory_order_acquire); site; site = site->_next)
+        f (*site);
+    }
+
+  private:
+    friend class Callsite;
+
+    struct Query {
+      std::optional<std::string> file {};
+      std::optional<std::string> function {};
+      std::optional<std::string> format {};
+      unsigned first { 0 };
+      unsigned last { ~0u };
+
+      static unsigned number (std::string_view s) {
+        unsigned n { 0 };
+        if (s.empty())
+          throw std::invalid_argument { "cxxlog: bad line number in callsite query" };
+
+        for (const auto c: s) {
+          if (c < '0' || c > '9')
+            throw std::invalid_argument { "cxxlog: bad line number in callsite query" };
+          n = n * 10 + static_cast<unsigned> (c - '0');
+        }
+
+        return n;
+      }
+
+      static Query parse (std::string_view query) {
+        Query q {};
+
+        while (!query.empty()) {
+          const auto start { query.find_first_not_of (' ') };
+          if (start == std::string_view::npos)
+            break;
+
+          query.remove_prefix (start);
+          const auto term { query.substr (0, query.find (' ')) };
+          query.remove_prefix (term.size());
+
+          const auto eq { term.find ('=') };
+          if (eq == std::string_view::npos)
+            throw std::invalid_argument { "cxxlog: callsite query terms must be key=value" };
+
+          const auto key { term.substr (0, eq) };
+          const auto value { term.substr (eq + 1) };
+
+          if (key == "file")
+            q.file = std::string { value };
+          else if (key == "func")
+            q.function = std::string { value };
+          else if (key == "format")
+            q.format = std::string { value };
+          else if (key == "line") {
+            const auto dash { value.find ('-') };
+            q.first = number (value.substr (0, dash));
+            q.last = dash == std::string_view::npos ? q.first : number (value.substr (dash + 1));
+          }
+          else
+            throw std::invalid_argument { "cxxlog: unknown callsite query key" };
+        }
+
+        return q;
+      }
+
+      bool matches (const Callsite &site) const noexcept {
+        if (file) {
+          const auto path { site.file() };
+          const auto slash { path.find_last_of ('/') };
+          const auto base { slash == std::string_view::npos ? path : path.substr (slash + 1) };
+          if (!detail::glob (*file, path) && !detail::glob (*file, base))
+            return false;
+        }
+
+        if (function && !detail::glob (*function, site.function()))
+          return false;
+
+        if (format && site.format().find (*format) == std::string_view::npos)
+          return false;
+
+        return site.line() >= first && site.line() <= last;
+      }
+    };
+
+    static std::size_t set (std::string_view query, bool enabled) {
+      auto q { Query::parse (query) };
+
+      // registration takes the same lock, so a statement either sees the query or is scanned
+      const std::lock_guard lock { mutex() };
+
+      std::size_t count { 0 };
+      for (auto *site = Callsite::head().load (std::memory_order_acquire); site; site = site->_next) {
+        if (q.matches (*site)) {
+          site->_enabled.store (enabled, std::memory_order_relaxed);
+          ++count;
+        }
+      }
+
+      queries().emplace_back (std::move (q), enabled);
+      return count;
+    }
+
+    // Adds a statement to the registered ones and applies the queries given so far.
+    static void add (Callsite &site) {
+      const std::lock_guard lock { mutex() };
+
+      for (const auto &[q, enabled]: queries()) {
+        if (q.matches (site))
+          site._enabled.store (enabled, std::memory_order_relaxed);
+      }
+
+      site._next = Callsite::head().load (std::memory_order_relaxed);
+      Callsite::head().store (&site, std::memory_order_release);
+    }
+
+    static std::mutex & mutex () noexcept {
+      static std::mutex m {};
+      return m;
+    }
+
+    static std::vector<std::pair<Query, bool>> & queries () noexcept {
+      static std::vector<std::pair<Query, bool>> q {};
+      return q;
+    }
+};
+
+inline Callsite::Callsite (const char *file, unsigned line, const char *function, std::string_view format):
+  _file { file },
+  _line { line },
+  _function { function },
+  _format { format }
+{
+  Callsites::add (*this);
+}
+
+}
+
+/// @brief Logs a message through a Logger from a statement with its own Callsite switch: the
+/// message is output if the Logger is enabled for its severity level, or if the statement was
+/// switched on with Callsites::enable().
+/// @param logger The Logger.
+/// @param severity The severity level of the message.
+/// @param fmt The format string literal, followed by the arguments and the fields.
+#define CXXLOG_LOG(logger, severity, fmt, ...)                                                     \
+  do {                                                                                             \
+    static ::cxxlog::Callsite cxxlog_callsite_ { __FILE__, __LINE__, __func__, fmt };              \
+    (logger).logIf (cxxlog_callsite_.enabled() || (logger).isEnabled (severity), severity, fmt     \
+      __VA_OPT__(,) __VA_ARGS__);                                                                  \
+  } while (false)
+
+/// @brief Logs a verbose-level message with a Callsite switch (see CXXLOG_LOG).
+#define CXXLOG_VERBOSE(logger, fmt, ...) CXXLOG_LOG (logger, ::cxxlog::Severity::kVerbose, fmt __VA_OPT__(,) __VA_ARGS__)
+
+/// @brief Logs a debug-level message with a Callsite switch (see CXXLOG_LOG).
+#define CXXLOG_DEBUG(logger, fmt, ...) CXXLOG_LOG (logger, ::cxxlog::Severity::kDebug, fmt __VA_OPT__(,) __VA_ARGS__)
+
+#endif
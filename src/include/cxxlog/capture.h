@@ -0,0 +1,392 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_CAPTURE_H__
+#define __CXX_LOGGER_CAPTURE_H__
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <cxxlog/crash.h>
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog {
+
+/// @cond Doxygen_Suppress
+namespace detail {
+  /// Encoding of the log call arguments which can be stored as raw bytes and formatted later.
+  /// Other argument types make the call fall back to formatting the message straight away.
+  template<typename T>
+  struct LazyArg;
+
+  template<typename T>
+    requires std::is_arithmetic_v<T>
+  struct LazyArg<T> {
+    using stored_type = T;
+
+    static std::size_t size (T) noexcept { return sizeof (T); }
+
+    static char * encode (char *p, T v) noexcept {
+      std::memcpy (p, &v, sizeof (T));
+      return p + sizeof (T);
+    }
+
+    static T decode (const char *&p) noexcept {
+      T v;
+      std::memcpy (&v, p, sizeof (T));
+      p += sizeof (T);
+      return v;
+    }
+
+    static void write (const char *&p, RawWriter &out) noexcept { out.append (decode (p)); }
+  };
+
+  /// Strings are copied: the captured call must not refer to the caller's buffers.
+  struct LazyString {
+    using stored_type = std::string_view;
+
+    static std::size_t size (std::string_view s) noexcept { return sizeof (std::uint32_t) + s.size(); }
+
+    static char * encode (char *p, std::string_view s) noexcept {
+      const auto n { static_cast<std::uint32_t> (s.size()) };
+      std::memcpy (p, &n, sizeof (n));
+      std::memcpy (p + sizeof (n), s.data(), s.size());
+      return p + sizeof (n) + s.size();
+    }
+
+    static std::string_view decode (const char *&p) noexcept {
+      std::uint32_t n;
+      std::memcpy (&n, p, sizeof (n));
+      const std::string_view s { p + sizeof (n), n };
+      p += sizeof (n) + n;
+      return s;
+    }
+
+    static void write (const char *&p, RawWriter &out) noexcept { out.append (decode (p)); }
+  };
+
+  template<> struct LazyArg<const char *>: LazyString {};
+  template<> struct LazyArg<char *>: LazyString {};
+  template<> struct LazyArg<std::string>: LazyString {};
+  template<> struct LazyArg<std::string_view>: LazyString {};
+
+  template<>
+  struct LazyArg<Field> {
+    using stored_type = Field;
+
+    static std::size_t size (const Field &f) noexcept {
+      return LazyString::size (f.key) + 1 + std::visit ([] (const auto &v) {
+        if constexpr (std::is_same_v<std::decay_t<decltype (v)>, std::string>)
+          return LazyString::size (v);
+        else
+          return sizeof (v);
+      }, f.value);
+    }
+
+    static char * encode (char *p, const Field &f) noexcept {
+      p = LazyString::encode (p, f.key);
+      *p++ = static_cast<char> (f.value.index());
+
+      return std::visit ([ p ] (const auto &v) {
+        using V = std::decay_t<decltype (v)>;
+
+        if constexpr (std::is_same_v<V, std::string>)
+          return LazyString::encode (p, v);
+        else
+          return LazyArg<V>::encode (p, v);
+      }, f.value);
+    }
+
+    static Field decode (const char *&p) {
+      Field f { std::string { LazyString::decode (p) }, {} };
+
+      switch (*p++) {
+        case 0: f.value = LazyArg<bool>::decode (p); break;
+        case 1: f.value = LazyArg<std::int64_t>::decode (p); break;
+        case 2: f.value = LazyArg<std::uint64_t>::decode (p); break;
+        case 3: f.value = LazyArg<double>::decode (p); break;
+        default: f.value = std::string { LazyString::decode (p) }; break;
+      }
+
+      return f;
+    }
+
+    /// Writes "key=value" without allocating.
+    static void write (const char *&p, RawWriter &out) noexcept {
+      out.append (LazyString::decode (p));
+      out.append ('=');
+
+      switch (*p++) {
+        case 0: LazyArg<bool>::write (p, out); break;
+        case 1: LazyArg<std::int64_t>::write (p, out); break;
+        case 2: LazyArg<std::uint64_t>::write (p, out); break;
+        case 3: LazyArg<double>::write (p, out); break;
+        default: LazyString::write (p, out); break;
+      }
+    }
+  };
+
+  template<typename T>
+  concept LazyEncodable = requires { typename LazyArg<std::decay_t<T>>::stored_type; };
+
+  /// A log call stored in a buffer, which can be turned into a Record later.
+  ///
+  /// The buffer starts with a header pointing to the functions which decode the rest of the
+  /// entry: either a copy of the format string followed by the raw arguments of the call, or the
+  /// already formatted message and its fields.
+  class CapturedCall {
+    public:
+      struct Codec {
+        Record (*decode) (const char *entry, std::size_t size);
+        void (*write) (const char *entry, RawWriter &out) noexcept;
+      };
+
+      /// Size of the header of every entry.
+      static constexpr std::size_t kHeaderSize { sizeof (const Codec *) + sizeof (std::int64_t) + sizeof (std::uint64_t) + 1 };
+
+      /// Stores a log call which hasn't been formatted. Returns the entry size, or 0 if it doesn't fit.
+      template<typename... Args>
+      static std::size_t capture (char *buf, std::size_t capacity, Severity s, std::chrono::milliseconds ts, std::string_view fmt, const Args &... args) {
+        if constexpr ((LazyEncodable<Args> && ...)) {
+          const auto size { kHeaderSize + LazyString::size (fmt) + (LazyArg<std::decay_t<Args>>::size (args) + ... + 0) };
+          if (size <= capacity) {
+            auto *p { header (buf, &kLazyCodec<std::decay_t<Args>...>, s, ts) };
+            p = LazyString::encode (p, fmt);
+            ((p = LazyArg<std::decay_t<Args>>::encode (p, args)), ...);
+
+            return size;
+          }
+        }
+
+        // not encodable or too large: format it now
+        constexpr auto kFormatArgs { countFormatArgs<Args...>() };
+        std::string msg {};
+        std::vector<Field> fields {};
+
+        [ & ]<std::size_t... I, std::size_t... F> (std::index_sequence<I...>, std::index_sequence<F...>) {
+          const auto tuple { std::forward_as_tuple (args...) };
+          fmtlib::vformat_to (std::back_inserter (msg), fmt, fmtlib::make_format_args (std::get<I> (tuple)...));
+          (fields.push_back (std::get<kFormatArgs + F> (tuple)), ...);
+        } (std::make_index_sequence<kFormatArgs> {}, std::make_index_sequence<sizeof... (Args) - kFormatArgs> {});
+
+        return store (buf, capacity, Record { std::move (msg), s, ts, std::move (fields) });
+      }
+
+      /// Stores a formatted record, truncating its message if needed. Returns the entry size, or 0
+      /// if it doesn't fit.
+      static std::size_t store (char *buf, std::size_t capacity, const Record &record) {
+        auto size { kHeaderSize + LazyString::size ({}) + sizeof (std::uint32_t) };
+        std::size_t fields { 0 };
+        for (const auto &field: record.fields()) {
+          if (size + LazyArg<Field>::size (field) > capacity)
+            break;
+
+          size += LazyArg<Field>::size (field);
+          ++fields;
+        }
+
+        if (size > capacity)
+          return 0;
+
+        const auto msgSize { std::min (record.message().size(), capacity - size) };
+
+        auto *p { header (buf, &kRecordCodec, record.severity(), record.timestamp(), record.thread()) };
+        p = LazyString::encode (p, { record.message().data(), msgSize });
+
+        const auto count { static_cast<std::uint32_t> (fields) };
+        std::memcpy (p, &count, sizeof (count));
+        p += sizeof (count);
+        for (std::size_t i = 0; i < fields; ++i)
+          p = LazyArg<Field>::encode (p, record.fields()[i]);
+
+        return size + msgSize;
+      }
+
+      /// Creates the record of a stored entry.
+      static Record decode (const char *entry, std::size_t size) {
+        return codec (entry)->decode (entry, size);
+      }
+
+      /// Writes a stored entry as a line of text, using only async-signal-safe operations. The
+      /// replacement fields of the format string are filled in order and their format
+      /// specifications are ignored.
+      static void write (const char *entry, RawWriter &out) noexcept {
+        codec (entry)->write (entry, out);
+      }
+
+      /// Gets the severity level of a stored entry.
+      static Severity severity (const char *entry) noexcept {
+        return static_cast<Severity> (entry[kHeaderSize - 1]);
+      }
+
+    private:
+      static const Codec * codec (const char *entry) noexcept {
+        const Codec *c;
+        std::memcpy (&c, entry, sizeof (c));
+        return c;
+      }
+
+      static char * header (char *p, const Codec *c, Severity s, std::chrono::milliseconds ts, std::uint64_t thread = threadId()) noexcept {
+        const std::int64_t t { ts.count() };
+
+        std::memcpy (p, &c, sizeof (c));
+        std::memcpy (p + sizeof (c), &t, sizeof (t));
+        std::memcpy (p + sizeof (c) + sizeof (t), &thread, sizeof (thread));
+        p[kHeaderSize - 1] = static_cast<char> (s);
+
+        return p + kHeaderSize;
+      }
+
+      static void readHeader (const char *p, Severity &s, std::chrono::milliseconds &ts, std::uint64_t &thread) noexcept {
+        std::int64_t t;
+        std::memcpy (&t, p + sizeof (const Codec *), sizeof (t));
+        std::memcpy (&thread, p + sizeof (const Codec *) + sizeof (t), sizeof (thread));
+
+        s = static_cast<Severity> (p[kHeaderSize - 1]);
+        ts = std::chrono::milliseconds { t };
+      }
+
+      template<typename... Ts>
+      static Record decodeLazy (const char *entry, std::size_t) {
+        Severity s;
+        std::chrono::milliseconds ts;
+        std::uint64_t thread;
+        readHeader (entry, s, ts, thread);
+
+        const char *p { entry + kHeaderSize };
+        const auto fmt { LazyString::decode (p) };
+
+        // braced initialization decodes the arguments in order
+        const std::tuple<typename LazyArg<Ts>::stored_type...> args { LazyArg<Ts>::decode (p)... };
+
+        constexpr auto kFormatArgs { countFormatArgs<Ts...>() };
+        std::string msg {};
+        std::vector<Field> fields {};
+
+        [ & ]<std::size_t... I, std::size_t... F> (std::index_sequence<I...>, std::index_sequence<F...>) {
+          fmtlib::vformat_to (std::back_inserter (msg), fmt, fmtlib::make_format_args (std::get<I> (args)...));
+          (fields.push_back (std::get<kFormatArgs + F> (args)), ...);
+        } (std::make_index_sequence<kFormatArgs> {}, std::make_index_sequence<sizeof... (Ts) - kFormatArgs> {});
+
+        return { std::move (msg), s, ts, std::move (fields), thread };
+      }
+
+      static Record decodeRecord (const char *entry, std::size_t) {
+        Severity s;
+        std::chrono::milliseconds ts;
+        std::uint64_t thread;
+        readHeader (entry, s, ts, thread);
+
+        const char *p { entry + kHeaderSize };
+        const auto msg { LazyString::decode (p) };
+
+        std::uint32_t count;
+        std::memcpy (&count, p, sizeof (count));
+        p += sizeof (count);
+
+        std::vector<Field> fields {};
+        fields.reserve (count);
+        for (std::uint32_t i = 0; i < count; ++i)
+          fields.push_back (LazyArg<Field>::decode (p));
+
+        return { std::string { msg }, s, ts, std::move (fields), thread };
+      }
+
+      // Writes the text of the format string up to the next replacement field, or all of it.
+      static void writeText (std::string_view &fmt, RawWriter &out, bool untilField) noexcept {
+        while (!fmt.empty()) {
+          const auto c { fmt.front() };
+          fmt.remove_prefix (1);
+
+          if ((c == '{' || c == '}') && !fmt.empty() && fmt.front() == c) {
+            fmt.remove_prefix (1);
+          }
+          else if (c == '{' && untilField) {
+            const auto end { fmt.find ('}') };
+            fmt.remove_prefix (end == std::string_view::npos ? fmt.size() : end + 1);
+            return;
+          }
+
+          out.append (c);
+        }
+      }
+
+      template<std::size_t I, std::size_t kFormatArgs, typename T>
+      static void writeArg (std::string_view &fmt, const char *&p, RawWriter &out) noexcept {
+        if constexpr (I < kFormatArgs) {
+          writeText (fmt, out, true);
+        }
+        else {
+          if constexpr (I == kFormatArgs)
+            writeText (fmt, out, false);
+          out.append (' ');
+        }
+
+        LazyArg<T>::write (p, out);
+      }
+
+      template<typename... Ts>
+      static void writeLazy (const char *entry, RawWriter &out) noexcept {
+        Severity s;
+        std::chrono::milliseconds ts;
+        std::uint64_t thread;
+        readHeader (entry, s, ts, thread);
+
+        const char *p { entry + kHeaderSize };
+        auto fmt { LazyString::decode (p) };
+        constexpr auto kFormatArgs { countFormatArgs<Ts...>() };
+
+        out.header (s, ts);
+        [ & ]<std::size_t... I> (std::index_sequence<I...>) {
+          (writeArg<I, kFormatArgs, Ts> (fmt, p, out), ...);
+        } (std::index_sequence_for<Ts...> {});
+
+        if constexpr (kFormatArgs == sizeof... (Ts))
+          writeText (fmt, out, false);
+        out.append ('\n');
+      }
+
+      static void writeRecord (const char *entry, RawWriter &out) noexcept {
+        Severity s;
+        std::chrono::milliseconds ts;
+        std::uint64_t thread;
+        readHeader (entry, s, ts, thread);
+
+        const char *p { entry + kHeaderSize };
+        out.header (s, ts);
+        LazyString::write (p, out);
+
+        std::uint32_t count;
+        std::memcpy (&count, p, sizeof (count));
+        p += sizeof (count);
+        for (std::uint32_t i = 0; i < count; ++i) {
+          out.append (' ');
+          LazyArg<Field>::write (p, out);
+        }
+        out.append ('\n');
+      }
+
+      template<typename... Ts>
+      static constexpr Codec kLazyCodec { &decodeLazy<Ts...>, &writeLazy<Ts...> };
+
+      static constexpr Codec kRecordCodec { &decodeRecord, &writeRecord };
+  };
+}
+/// @endcond
+
+}
+
+#endif
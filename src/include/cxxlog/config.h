@@ -0,0 +1,341 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_CONFIG_H__
+#define __CXX_LOGGER_CONFIG_H__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cinttypes>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/registry.h>
+
+
+namespace cxxlog {
+
+/// @cond Doxygen_Suppress
+namespace detail {
+  /// Parses a severity level name ("verbose", "debug", "info", "warn" or "warning", "error",
+  /// "fatal", "none", in any case) or its letter ("V", "D", "I", "W", "E", "F").
+  inline Severity parseSeverity (std::string_view name) {
+    std::string lower { name };
+    for (auto &c: lower)
+      c = static_cast<char> ((c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c);
+
+    constexpr std::array<std::pair<std::string_view, Severity>, 15> kNames { {
+      { "verbose", Severity::kVerbose }, { "v", Severity::kVerbose },
+      { "debug", Severity::kDebug }, { "d", Severity::kDebug },
+      { "info", Severity::kInfo }, { "i", Severity::kInfo },
+      { "warn", Severity::kWarn }, { "warning", Severity::kWarn }, { "w", Severity::kWarn },
+      { "error", Severity::kError }, { "e", Severity::kError },
+      { "fatal", Severity::kFatal }, { "f", Severity::kFatal },
+      { "none", Severity::kNone }, { "off", Severity::kNone }
+    } };
+
+    for (const auto &[n, s]: kNames) {
+      if (n == lower)
+        return s;
+    }
+
+    throw std::invalid_argument { "cxxlog: unknown severity level '" + std::string { name } + "'" };
+  }
+
+  inline std::string_view trim (std::string_view s) noexcept {
+    const auto first { s.find_first_not_of (" \t\r") };
+    if (first == std::string_view::npos)
+      return {};
+
+    return s.substr (first, s.find_last_not_of (" \t\r") - first + 1);
+  }
+}
+/// @endcond
+
+/// @class ConfigWatcher
+/// @brief Applies the logging settings of a configuration file, and applies them again whenever
+/// the file changes.
+///
+/// The file holds `key = value` lines; `#` starts a comment. Each key is bound to a setting
+/// with level(), levels() or on(); the keys which aren't bound are ignored:
+///
+/// @code
+///   # logging.conf
+///   level = info
+///   level.net = debug
+///   file.path = /var/log/app.log
+/// @endcode
+///
+/// @code
+///   cxxlog::ConfigWatcher config { "/etc/app/logging.conf" };
+///   config.level ("level", logger);
+///   config.levels ("level.", registry);
+///   config.on ("file.path", [ & ] (std::string_view path) { ... });
+///   config.start();
+/// @endcode
+///
+/// start() applies the file, then watches its directory with inotify on a background thread, so
+/// editors which replace the file are also noticed. A reload parses the whole file and checks
+/// every value before applying any, so a malformed file changes nothing; the errors of the
+/// background reloads are passed to the onError() handler. Applying a level is an atomic store,
+/// so a reload never blocks the logging threads.
+///
+/// The bindings must be set up before start(). The watcher stops when it is destroyed.
+class ConfigWatcher {
+  public:
+    /// @brief Constructor for the ConfigWatcher class.
+    /// @param path The path of the configuration file.
+    explicit ConfigWatcher (std::string path): _path { std::move (path) } {
+      // empty
+    }
+
+    ConfigWatcher (const ConfigWatcher &) = delete;
+    ConfigWatcher & operator= (const ConfigWatcher &) = delete;
+
+    ~ConfigWatcher () { stop(); }
+
+    /// @brief Binds a key to a custom setting, such as a transport parameter.
+    /// @param key The key.
+    /// @param apply The function called with the value of the key on every reload. It may throw
+    /// to report an invalid value, but the other settings may have been applied already.
+    void on (std::string key, std::function<void (std::string_view)> apply) {
+      _bindings.push_back ({ std::move (key), false, [ apply = std::move (apply) ] (std::string_view, std::string_view value) {
+        return std::function<void ()> { [ apply, v = std::string { value } ] () { apply (v); } };
+      } });
+    }
+
+    /// @brief Binds a key to the severity level threshold of a Logger.
+    /// @param key The key.
+    /// @param logger The logger, which must outlive the watcher.
+    template<Loggable... Ts>
+    void level (std::string key, Logger<Ts...> &logger) {
+      _bindings.push_back ({ std::move (key), false, [ &logger ] (std::string_view, std::string_view value) {
+        return std::function<void ()> { [ &logger, s = detail::parseSeverity (value) ] () { logger.setLevel (s); } };
+      } });
+    }
+
+    /// @brief Binds the keys starting with a prefix to the levels of the named loggers of a
+    /// Registry: `prefix + name = level`. When a reload no longer finds a key the previous one
+    /// applied, the named logger inherits the level of its parent again.
+    /// @param prefix The prefix of the keys, e.g. "level.". The key equal to the prefix without
+    /// its last character (e.g. "level") sets the root logger, which keeps its level when the key
+    /// is removed.
+    /// @param registry The registry.
+    template<Loggable... Ts>
+    void levels (std::string prefix, const Registry<Ts...> &registry) {
+      _bindings.push_back ({ std::move (prefix), true, [ registry ] (std::string_view name, std::string_view value) {
+        return std::function<void ()> { [ registry, n = std::string { name }, s = detail::parseSeverity (value) ] () { registry.setLevel (n, s); } };
+      }, [ registry ] (std::string_view name) { registry.resetLevel (name); } });
+    }
+
+    /// @brief Sets the handler of the errors of the background reloads.
+    /// @param handler The function called with the error.
+    void onError (std::function<void (const std::exception &)> handler) { _onError = std::move (handler); }
+
+    /// @brief Applies the file, then watches it on a background thread.
+    /// @throws std::system_error if the file can't be read or watched.
+    /// @throws std::invalid_argument if the file is malformed.
+    void start () {
+      reload();
+
+      _inotify = ::inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+      if (_inotify < 0)
+        throw std::system_error { errno, std::generic_category(), "cxxlog: inotify_init1" };
+
+      const auto slash { _path.find_last_of ('/') };
+      const auto dir { slash == std::string::npos ? std::string { "." } : (slash == 0 ? std::string { "/" } : _path.substr (0, slash)) };
+      _name = slash == std::string::npos ? _path : _path.substr (slash + 1);
+
+      if (::inotify_add_watch (_inotify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0 || ::pipe2 (_wake.data(), O_CLOEXEC) < 0) {
+        const auto error { errno };
+        close();
+        throw std::system_error { error, std::generic_category(), "cxxlog: watching " + dir };
+      }
+
+      _worker = std::thread { [ this ] () { run(); } };
+    }
+
+    /// @brief Stops watching the file. Called by the destructor.
+    void stop () {
+      if (!_worker.joinable())
+        return;
+
+      const char c { 0 };
+      while (::write (_wake[1], &c, 1) < 0 && errno == EINTR) {
+        // retry
+      }
+
+      _worker.join();
+      close();
+    }
+
+    /// @brief Reads and applies the file now.
+    /// @throws std::system_error if the file can't be read.
+    /// @throws std::invalid_argument if the file is malformed.
+    void reload () {
+      std::ifstream in { _path };
+      if (!in)
+        throw std::system_error { errno, std::generic_category(), "cxxlog: reading " + _path };
+
+      std::stringstream ss {};
+      ss << in.rdbuf();
+
+      apply (ss.str());
+    }
+
+    /// @brief Gets the number of times the file was applied.
+    /// @return The number of successful reloads.
+    std::uint64_t reloads () const noexcept { return _reloads.load (std::memory_order_relaxed); }
+
+  private:
+    struct Binding {
+      std::string key;
+      bool prefix;
+      std::function<std::function<void ()> (std::string_view name, std::string_view value)> prepare;
+      // for the prefix bindings: undoes the setting of a name which was removed from the file
+      std::function<void (std::string_view name)> reset {};
+      // the names set by the last reload
+      std::vector<std::string> names {};
+    };
+
+    void apply (std::string_view text) {
+      // parse and check everything first, so a malformed file changes nothing
+      std::vector<std::function<void ()>> changes {};
+      std::vector<std::vector<std::string>> names (_bindings.size());
+
+      for (std::size_t number = 1; !text.empty(); ++number) {
+        const auto end { text.find ('\n') };
+        auto line { text.substr (0, end) };
+        text.remove_prefix (end == std::string_view::npos ? text.size() : end + 1);
+
+        line = detail::trim (line.substr (0, line.find ('#')));
+        if (line.empty())
+          continue;
+
+        const auto eq { line.find ('=') };
+        if (eq == std::string_view::npos)
+          throw std::invalid_argument { "cxxlog: " + _path + ":" + std::to_string (number) + ": expected key = value" };
+
+        const auto key { detail::trim (line.substr (0, eq)) };
+        const auto value { detail::trim (line.substr (eq + 1)) };
+
+        for (std::size_t i = 0; i < _bindings.size(); ++i) {
+          const auto &binding { _bindings[i] };
+          if (!binding.prefix && key == binding.key)
+            changes.push_back (binding.prepare (key, value));
+          else if (binding.prefix && key.starts_with (binding.key)) {
+            changes.push_back (binding.prepare (key.substr (binding.key.size()), value));
+            names[i].emplace_back (key.substr (binding.key.size()));
+          }
+          else if (binding.prefix && !binding.key.empty() && key == std::string_view { binding.key }.substr (0, binding.key.size() - 1)) {
+            changes.push_back (binding.prepare ({}, value));
+            names[i].emplace_back();
+          }
+        }
+      }
+
+      const std::lock_guard lock { _mutex };
+      for (std::size_t i = 0; i < _bindings.size(); ++i) {
+        auto &binding { _bindings[i] };
+        if (!binding.reset)
+          continue;
+
+        // reset first, so the levels still in the file are set over the inherited ones
+        for (const auto &name: binding.names) {
+          if (std::find (names[i].begin(), names[i].end(), name) == names[i].end())
+            binding.reset (name);
+        }
+
+        binding.names = std::move (names[i]);
+      }
+
+      for (const auto &change: changes)
+        change();
+
+      _reloads.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    void run () {
+      alignas (inotify_event) char buffer[4096];
+      std::array<pollfd, 2> fds { { { _inotify, POLLIN, 0 }, { _wake[0], POLLIN, 0 } } };
+
+      for (;;) {
+        if (::poll (fds.data(), fds.size(), -1) < 0) {
+          if (errno == EINTR)
+            continue;
+          return;
+        }
+
+        if (fds[1].revents)
+          return;
+
+        bool changed { false };
+        for (;;) {
+          const auto n { ::read (_inotify, buffer, sizeof (buffer)) };
+          if (n <= 0)
+            break;
+
+          for (ssize_t i = 0; i < n; ) {
+            const auto *event { reinterpret_cast<const inotify_event *> (buffer + i) };
+            if (event->len > 0 && _name == event->name)
+              changed = true;
+            i += static_cast<ssize_t> (sizeof (inotify_event) + event->len);
+          }
+        }
+
+        if (!changed)
+          continue;
+
+        try {
+          reload();
+        }
+        catch (const std::exception &e) {
+          if (_onError)
+            _onError (e);
+        }
+      }
+    }
+
+    void close () noexcept {
+      for (auto *fd: { &_inotify, &_wake[0], &_wake[1] }) {
+        if (*fd >= 0)
+          ::close (*fd);
+        *fd = -1;
+      }
+    }
+
+    std::string _path;
+    std::string _name {};
+    std::vector<Binding> _bindings {};
+    std::function<void (const std::exception &)> _onError {};
+
+    std::mutex _mutex {};
+    std::atomic<std::uint64_t> _reloads { 0 };
+
+    int _inotify { -1 };
+    std::array<int, 2> _wake { -1, -1 };
+    std::thread _worker {};
+};
+
+}
+
+#endif
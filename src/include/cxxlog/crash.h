@@ -0,0 +1,395 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_CRASH_H__
+#define __CXX_LOGGER_CRASH_H__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog {
+
+/// @cond Doxygen_Suppress
+namespace detail {
+  /// Buffered writer to a file descriptor which only uses async-signal-safe operations: no
+  /// allocations, no locks and raw `write` calls. Lines follow the default layout:
+  /// "YYYY-MM-DDTHH:MM:SS S: message key=value".
+  class RawWriter {
+    public:
+      explicit RawWriter (int fd) noexcept: _fd { fd } {
+        // empty
+      }
+
+      RawWriter (const RawWriter &) = delete;
+      RawWriter & operator= (const RawWriter &) = delete;
+
+      ~RawWriter () { flush(); }
+
+      void append (std::string_view s) noexcept {
+        while (!s.empty()) {
+          if (_size == sizeof (_buf))
+            flush();
+
+          const auto n { std::min (s.size(), sizeof (_buf) - _size) };
+          std::memcpy (_buf + _size, s.data(), n);
+          _size += n;
+          s.remove_prefix (n);
+        }
+      }
+
+      void append (char c) noexcept { append (std::string_view { &c, 1 }); }
+
+      void append (bool v) noexcept { append (v ? std::string_view { "true" } : std::string_view { "false" }); }
+
+      void append (std::uint64_t v) noexcept {
+        char digits[20];
+        std::size_t n { 0 };
+        do {
+          digits[sizeof (digits) - ++n] = static_cast<char> ('0' + v % 10);
+          v /= 10;
+        } while (v != 0);
+
+        append (std::string_view { digits + sizeof (digits) - n, n });
+      }
+
+      void append (std::int64_t v) noexcept {
+        if (v < 0) {
+          append ('-');
+          append (static_cast<std::uint64_t> (0) - static_cast<std::uint64_t> (v));
+        }
+        else {
+          append (static_cast<std::uint64_t> (v));
+        }
+      }
+
+      /// Fixed notation with up to 6 decimals; magnitudes beyond 2^63 are written as "inf".
+      void append (double v) noexcept {
+        if (std::isnan (v)) {
+          append (std::string_view { "nan" });
+          return;
+        }
+
+        if (std::signbit (v)) {
+          append ('-');
+          v = -v;
+        }
+
+        if (v >= 9.2e18) {
+          append (std::string_view { "inf" });
+          return;
+        }
+
+        auto integer { static_cast<std::uint64_t> (v) };
+        auto frac { static_cast<std::uint64_t> (std::llround ((v - static_cast<double> (integer)) * 1e6)) };
+        if (frac >= 1000000) {
+          ++integer;
+          frac -= 1000000;
+        }
+
+        append (integer);
+        if (frac != 0) {
+          char digits[7] { '.' };
+          for (int i = 6; i > 0; --i, frac /= 10)
+            digits[i] = static_cast<char> ('0' + frac % 10);
+
+          std::size_t n { 7 };
+          while (digits[n - 1] == '0')
+            --n;
+
+          append (std::string_view { digits, n });
+        }
+      }
+
+      template<typename T>
+        requires std::is_integral_v<T>
+      void append (T v) noexcept {
+        if constexpr (std::is_signed_v<T>)
+          append (static_cast<std::int64_t> (v));
+        else
+          append (static_cast<std::uint64_t> (v));
+      }
+
+      void append (float v) noexcept { append (static_cast<double> (v)); }
+
+      void append (long double v) noexcept { append (static_cast<double> (v)); }
+
+      void append (const FieldValue &value) noexcept {
+        if (const auto *v { std::get_if<bool> (&value) })
+          append (*v);
+        else if (const auto *v { std::get_if<std::int64_t> (&value) })
+          append (*v);
+        else if (const auto *v { std::get_if<std::uint64_t> (&value) })
+          append (*v);
+        else if (const auto *v { std::get_if<double> (&value) })
+          append (*v);
+        else if (const auto *v { std::get_if<std::string> (&value) })
+          append (std::string_view { *v });
+      }
+
+      /// Writes the "<timestamp> <severity>: " prefix of a line, without calling gmtime.
+      void header (Severity s, std::chrono::milliseconds ts) noexcept {
+        // days to civil date (H. Hinnant)
+        const auto secs { ts.count() >= 0 ? ts.count() / 1000 : (ts.count() - 999) / 1000 };
+        const auto days { secs >= 0 ? secs / 86400 : (secs - 86399) / 86400 };
+        const auto sod { secs - days * 86400 };
+
+        const auto z { days + 719468 };
+        const auto era { (z >= 0 ? z : z - 146096) / 146097 };
+        const auto doe { z - era * 146097 };
+        const auto yoe { (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365 };
+        const auto doy { doe - (365 * yoe + yoe / 4 - yoe / 100) };
+        const auto mp { (5 * doy + 2) / 153 };
+        const auto day { doy - (153 * mp + 2) / 5 + 1 };
+        const auto month { mp < 10 ? mp + 3 : mp - 9 };
+        const auto year { yoe + era * 400 + (month <= 2) };
+
+        const auto two { [ this ] (std::int64_t v) {
+          const char digits[2] { static_cast<char> ('0' + v / 10), static_cast<char> ('0' + v % 10) };
+          append (std::string_view { digits, 2 });
+        } };
+
+        append (year);
+        append ('-');
+        two (month);
+        append ('-');
+        two (day);
+        append ('T');
+        two (sod / 3600);
+        append (':');
+        two (sod / 60 % 60);
+        append (':');
+        two (sod % 60);
+        append (' ');
+        append (Logger<>::toCString (s)[0]);
+        append (std::string_view { ": " });
+      }
+
+      /// Writes a whole line for a formatted message and its fields.
+      void line (Severity s, std::chrono::milliseconds ts, std::string_view msg, std::span<const Field> fields) noexcept {
+        header (s, ts);
+        append (msg);
+        for (const auto &field: fields) {
+          append (' ');
+          append (std::string_view { field.key });
+          append ('=');
+          append (field.value);
+        }
+        append ('\n');
+      }
+
+      void flush () noexcept {
+        const char *p { _buf };
+        while (_size > 0) {
+          const auto n { ::write (_fd, p, _size) };
+          if (n < 0 && errno == EINTR)
+            continue;
+          if (n <= 0)
+            break;
+
+          p += n;
+          _size -= static_cast<std::size_t> (n);
+        }
+
+        _size = 0;
+      }
+
+    private:
+      int _fd;
+      std::size_t _size { 0 };
+      char _buf[1024];
+  };
+}
+/// @endcond
+
+/// @concept CrashDumpable
+///
+/// @brief A concept that represents transports which hold log messages in memory and can write
+/// them out from a signal handler.
+///
+/// @tparam T The type to be checked for CrashDumpable concept compliance.
+///
+/// @requirements
+/// - void T::crashDump(detail::RawWriter &) const noexcept
+///   Writes the pending messages using only async-signal-safe operations.
+template<typename T>
+concept CrashDumpable = requires (const T t, detail::RawWriter &out) {
+  { t.crashDump (out) } noexcept;
+};
+
+/// @class CrashHandler
+/// @brief Writes the log messages still held in memory to a file descriptor when the process
+/// receives a fatal signal.
+///
+/// While a CrashHandler exists, the given signals are handled by writing the pending messages
+/// of every watched transport (e.g. the queue of an Async wrapper or the ring of a
+/// FlightRecorder) to a file descriptor opened beforehand, followed by a final fatal line with
+/// the signal number. The previous handler of the signal is then restored and the signal is
+/// raised again, so the process still dies (and dumps core) as it would have:
+///
+/// @code
+///   const auto fd { ::open ("crash.log", O_WRONLY | O_CREAT | O_APPEND, 0644) };
+///   cxxlog::CrashHandler crash { fd };
+///   crash.watch (asyncTransport);
+/// @endcode
+///
+/// The handler only uses async-signal-safe operations: messages are written with raw `write`
+/// calls in the default layout, unformatted calls of a FlightRecorder are formatted by a minimal
+/// formatter which ignores format specifications, and nothing is allocated. The dump is a best
+/// effort: messages being modified by another thread at the time of the crash may be skipped.
+/// The handler runs on the stack of the crashing thread, or on its alternate signal stack if it
+/// has one (see `sigaltstack`).
+///
+/// Only one CrashHandler can exist at a time. The watched transports are kept alive until it is
+/// destroyed, which restores the previous signal handlers. The file descriptor is not closed.
+class CrashHandler {
+  public:
+    /// Maximum number of watched transports.
+    static constexpr std::size_t kMaxSources { 16 };
+
+    /// @brief Constructor for the CrashHandler class. Installs the signal handlers.
+    /// @param fd The file descriptor the pending messages are written to.
+    /// @param signals The signals to handle.
+    /// @throws std::logic_error If another CrashHandler exists.
+    /// @throws std::system_error If a signal handler can't be installed.
+    CrashHandler (int fd, std::initializer_list<int> signals = { SIGSEGV, SIGABRT, SIGBUS, SIGILL, SIGFPE }):
+      _fd { fd }
+    {
+      CrashHandler *expected { nullptr };
+      if (!active().compare_exchange_strong (expected, this))
+        throw std::logic_error { "a CrashHandler is already installed" };
+
+      struct sigaction action {};
+      action.sa_handler = &CrashHandler::onSignal;
+      action.sa_flags = SA_ONSTACK;
+      sigemptyset (&action.sa_mask);
+
+      for (const auto sig: signals) {
+        if (sig <= 0 || sig >= static_cast<int> (kMaxSignal) || ::sigaction (sig, &action, &_previous[static_cast<std::size_t> (sig)]) != 0) {
+          const auto error { errno != 0 ? errno : EINVAL };
+          restore();
+          active().store (nullptr);
+          throw std::system_error { error, std::generic_category(), "sigaction" };
+        }
+
+        _installed[static_cast<std::size_t> (sig)] = true;
+      }
+    }
+
+    CrashHandler (const CrashHandler &) = delete;
+    CrashHandler & operator= (const CrashHandler &) = delete;
+
+    /// @brief Destructor for the CrashHandler class. Restores the previous signal handlers.
+    ~CrashHandler () {
+      restore();
+      active().store (nullptr);
+    }
+
+    /// @brief Writes the pending messages of a transport when a signal is handled. Copies of
+    /// the transports in this library share their state, so the copy kept by the handler sees
+    /// the messages logged through the Logger.
+    /// @param transport The transport to watch.
+    /// @throws std::length_error If kMaxSources transports are already watched.
+    template<CrashDumpable T>
+    void watch (const T &transport) {
+      const auto n { _count.load (std::memory_order_relaxed) };
+      if (n == kMaxSources)
+        throw std::length_error { "too many transports watched by the CrashHandler" };
+
+      auto copy { std::make_shared<const T> (transport) };
+      _sources[n] = {
+        [] (const void *t, detail::RawWriter &out) noexcept { static_cast<const T *> (t)->crashDump (out); },
+        copy.get()
+      };
+      _keep.push_back (std::move (copy));
+
+      _count.store (n + 1, std::memory_order_release);
+    }
+
+  private:
+    static constexpr std::size_t kMaxSignal { 65 };
+
+    struct Source {
+      void (*dump) (const void *, detail::RawWriter &) noexcept;
+      const void *transport;
+    };
+
+    static std::atomic<CrashHandler *> & active () noexcept {
+      static std::atomic<CrashHandler *> handler { nullptr };
+      return handler;
+    }
+
+    static void onSignal (int sig) {
+      const auto savedErrno { errno };
+
+      if (auto *self { active().load() }; self && !self->_handling.exchange (true)) {
+        {
+          detail::RawWriter out { self->_fd };
+          for (std::size_t i = 0; i < self->_count.load (std::memory_order_acquire); ++i)
+            self->_sources[i].dump (self->_sources[i].transport, out);
+
+          struct timespec now {};
+          ::clock_gettime (CLOCK_REALTIME, &now);
+
+          out.header (Severity::kFatal, std::chrono::milliseconds { static_cast<std::int64_t> (now.tv_sec) * 1000 + now.tv_nsec / 1000000 });
+          out.append (std::string_view { "caught signal " });
+          out.append (sig);
+          out.append ('\n');
+        }
+
+        ::sigaction (sig, &self->_previous[static_cast<std::size_t> (sig)], nullptr);
+      }
+      else {
+        struct sigaction action {};
+        action.sa_handler = SIG_DFL;
+        sigemptyset (&action.sa_mask);
+        ::sigaction (sig, &action, nullptr);
+      }
+
+      errno = savedErrno;
+      ::raise (sig);
+    }
+
+    void restore () noexcept {
+      for (std::size_t sig = 0; sig < kMaxSignal; ++sig) {
+        if (_installed[sig])
+          ::sigaction (static_cast<int> (sig), &_previous[sig], nullptr);
+      }
+    }
+
+    int _fd;
+    std::array<struct sigaction, kMaxSignal> _previous {};
+    std::array<bool, kMaxSignal> _installed {};
+    std::array<Source, kMaxSources> _sources {};
+    std::atomic<std::size_t> _count { 0 };
+    std::atomic<bool> _handling { false };
+    std::vector<std::shared_ptr<const void>> _keep {};
+};
+
+}
+
+#endif
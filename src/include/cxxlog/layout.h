@@ -0,0 +1,389 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_LAYOUT_H__
+#define __CXX_LOGGER_LAYOUT_H__
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cinttypes>
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog {
+
+/// @cond Doxygen_Suppress
+namespace detail {
+  /// Maximum length of the "<timestamp> <severity>: " prefix written by formatHeader.
+  inline constexpr std::size_t kMaxHeaderSize { 32 };
+
+  /// Writes the "<timestamp> <severity>: " prefix of the default layout into @p buf
+  /// (at least kMaxHeaderSize bytes) and returns the number of characters written.
+  inline std::size_t formatHeader (char *buf, Severity s, std::chrono::milliseconds ts) noexcept {
+    auto epochSecs { std::chrono::system_clock::to_time_t (std::chrono::time_point<std::chrono::system_clock> (ts)) };
+
+    struct tm tmBuf {};
+    auto n { std::strftime (buf, kMaxHeaderSize - 4, "%FT%T", gmtime_r (&epochSecs, &tmBuf)) };
+
+    const char *sev { Logger<>::toCString (s) };
+    buf[n++] = ' ';
+    buf[n++] = sev[0];
+    buf[n++] = ':';
+    buf[n++] = ' ';
+
+    return n;
+  }
+
+  /// Appends the UTC time of @p ts as "YYYY-MM-DDTHH:MM:SS", rounded down to the second. The
+  /// text of the last second formatted by the calling thread is reused.
+  inline void appendIsoSeconds (std::string &out, std::chrono::milliseconds ts) {
+    thread_local std::time_t cachedSecs { -1 };
+    thread_local char cached[kMaxHeaderSize] {};
+    thread_local std::size_t cachedSize { 0 };
+
+    const auto epochSecs { static_cast<std::time_t> (std::chrono::floor<std::chrono::seconds> (ts).count()) };
+    if (epochSecs != cachedSecs || cachedSize == 0) {
+      struct tm tmBuf {};
+      cachedSize = std::strftime (cached, sizeof (cached), "%FT%T", gmtime_r (&epochSecs, &tmBuf));
+      cachedSecs = epochSecs;
+    }
+
+    out.append (cached, cachedSize);
+  }
+
+  /// Appends the UTC time of @p ts as "YYYY-MM-DDTHH:MM:SS.mmm", followed by "Z" if @p zone is
+  /// set.
+  inline void appendIsoTime (std::string &out, std::chrono::milliseconds ts, bool zone = true) {
+    appendIsoSeconds (out, ts);
+
+    const auto ms { static_cast<unsigned> ((ts - std::chrono::floor<std::chrono::seconds> (ts)).count()) };
+    const char frac[5] { '.', static_cast<char> ('0' + ms / 100), static_cast<char> ('0' + ms / 10 % 10), static_cast<char> ('0' + ms % 10), 'Z' };
+
+    out.append (frac, zone ? sizeof (frac) : sizeof (frac) - 1);
+  }
+
+  /// Character classes of the text encoder shared by the field values and the logfmt transport.
+  enum TextClass: std::uint8_t {
+    kTextQuote = 0x01, ///< A value containing the character must be quoted, and a key can't contain it.
+    kTextEscape = 0x02 ///< The character must be escaped inside a quoted value.
+  };
+
+  inline constexpr auto kTextClasses { [] () {
+    std::array<std::uint8_t, 256> table {};
+    for (int c = 0; c <= ' '; ++c)
+      table[static_cast<std::size_t> (c)] = kTextQuote;
+    for (int c = 0; c < ' '; ++c)
+      table[static_cast<std::size_t> (c)] |= kTextEscape;
+
+    table[0x7F] = kTextQuote;
+    table['='] = kTextQuote;
+    table['"'] = kTextQuote | kTextEscape;
+    table['\\'] = kTextEscape;
+
+    return table;
+  } () };
+
+  /// Appends @p s to @p out, quoted only if it is empty or contains a space, an equals sign, a
+  /// quote or a control character. Inside quotes, quotes and backslashes are escaped with a
+  /// backslash, line feeds, carriage returns and tabs as "\n", "\r" and "\t", and the other
+  /// control characters as "\u00XX".
+  inline void appendQuotedString (std::string &out, std::string_view s) {
+    std::uint8_t classes { static_cast<std::uint8_t> (s.empty() ? kTextQuote : 0) };
+    for (const char c: s)
+      classes |= kTextClasses[static_cast<unsigned char> (c)];
+
+    if (!(classes & kTextQuote)) {
+      out += s;
+      return;
+    }
+
+    out += '"';
+    if (!(classes & kTextEscape)) {
+      out += s;
+    }
+    else {
+      constexpr char kHex[] { "0123456789abcdef" };
+
+      std::size_t clean { 0 };
+      for (std::size_t i = 0; i < s.size(); ++i) {
+        const auto c { static_cast<unsigned char> (s[i]) };
+        if (!(kTextClasses[c] & kTextEscape))
+          continue;
+
+        out.append (s.data() + clean, i - clean);
+        clean = i + 1;
+
+        switch (c) {
+          case '"': out += "\\\""; break;
+          case '\\': out += "\\\\"; break;
+          case '\n': out += "\\n"; break;
+          case '\r': out += "\\r"; break;
+          case '\t': out += "\\t"; break;
+          default: {
+            const char seq[6] { '\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0x0F] };
+            out.append (seq, sizeof (seq));
+          }
+        }
+      }
+
+      out.append (s.data() + clean, s.size() - clean);
+    }
+    out += '"';
+  }
+
+  /// Appends a field value as text, with strings written by appendQuotedString().
+  inline void appendFieldValue (std::string &out, const FieldValue &value) {
+    std::visit ([ &out ] (const auto &v) {
+      using V = std::decay_t<decltype (v)>;
+
+      if constexpr (std::is_same_v<V, bool>) {
+        out += v ? "true" : "false";
+      }
+      else if constexpr (std::is_same_v<V, std::string>) {
+        appendQuotedString (out, v);
+      }
+      else {
+        char buf[32];
+        out.append (buf, std::to_chars (buf, buf + sizeof (buf), v).ptr);
+      }
+    }, value);
+  }
+
+  /// Appends " <key>=<value>" for every field of @p r.
+  inline void appendFields (std::string &out, const Record &r) {
+    for (const auto &field: r.fields()) {
+      out += ' ';
+      out += field.key;
+      out += '=';
+      appendFieldValue (out, field.value);
+    }
+  }
+
+  /// A string literal usable as a template argument.
+  template<std::size_t N>
+  struct FixedString {
+    constexpr FixedString (const char (&s)[N]) noexcept { std::copy_n (s, N, text); }
+
+    constexpr std::string_view view () const noexcept { return { text, N - 1 }; }
+
+    char text[N] {};
+  };
+
+  /// The placeholders of a PatternLayout.
+  enum class Placeholder: std::uint8_t { kText, kIsoTime, kIsoTimeMs, kEpochMs, kSeverity, kSeverityName, kThread, kFields, kMessage };
+
+  /// One emit step of a parsed pattern: a placeholder, or a slice of the pattern text.
+  struct Step {
+    Placeholder placeholder { Placeholder::kText };
+    std::size_t offset { 0 };
+    std::size_t size { 0 };
+  };
+
+  inline constexpr std::array<std::pair<std::string_view, Placeholder>, 9> kPlaceholders { {
+    { "ts", Placeholder::kIsoTime },
+    { "ts:iso", Placeholder::kIsoTime },
+    { "ts:iso_ms", Placeholder::kIsoTimeMs },
+    { "ts:epoch_ms", Placeholder::kEpochMs },
+    { "sev", Placeholder::kSeverity },
+    { "sev:name", Placeholder::kSeverityName },
+    { "thread", Placeholder::kThread },
+    { "fields", Placeholder::kFields },
+    { "msg", Placeholder::kMessage }
+  } };
+
+  inline constexpr std::array<const char *, 6> kSeverityNames { "VERBOSE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL" };
+
+  /// Splits a pattern into steps, storing them in @p steps (if not null) and returning how many
+  /// there are. Throws (a compile-time error when evaluated in a constant expression) if the
+  /// pattern has an unknown or unterminated placeholder, or doesn't have exactly one "{msg}".
+  constexpr std::size_t parsePattern (std::string_view pattern, Step *steps) {
+    std::size_t count { 0 };
+    std::size_t messages { 0 };
+    const auto push { [ &count, steps ] (Step step) {
+      if (steps)
+        steps[count] = step;
+      ++count;
+    } };
+
+    std::size_t text { 0 };
+    for (std::size_t i = 0; i < pattern.size();) {
+      const char c { pattern[i] };
+      if ((c == '{' || c == '}') && i + 1 < pattern.size() && pattern[i + 1] == c) {
+        // "{{" and "}}" write a single brace
+        push ({ Placeholder::kText, text, i + 1 - text });
+        i += 2;
+        text = i;
+      }
+      else if (c == '{') {
+        const auto end { pattern.find ('}', i) };
+        if (end == std::string_view::npos)
+          throw "cxxlog: unterminated placeholder in pattern";
+
+        const auto name { pattern.substr (i + 1, end - i - 1) };
+        const auto *placeholder { std::find_if (kPlaceholders.begin(), kPlaceholders.end(), [ name ] (const auto &f) { return f.first == name; }) };
+        if (placeholder == kPlaceholders.end())
+          throw "cxxlog: unknown placeholder in pattern";
+
+        if (i > text)
+          push ({ Placeholder::kText, text, i - text });
+        push ({ placeholder->second, 0, 0 });
+        messages += placeholder->second == Placeholder::kMessage;
+
+        i = end + 1;
+        text = i;
+      }
+      else if (c == '}') {
+        throw "cxxlog: unmatched '}' in pattern";
+      }
+      else {
+        ++i;
+      }
+    }
+
+    if (pattern.size() > text)
+      push ({ Placeholder::kText, text, pattern.size() - text });
+
+    if (messages != 1)
+      throw "cxxlog: the pattern must contain exactly one {msg}";
+
+    return count;
+  }
+
+  template<FixedString P>
+  constexpr auto parsePattern () {
+    std::array<Step, parsePattern (P.view(), nullptr)> steps {};
+    parsePattern (P.view(), steps.data());
+
+    return steps;
+  }
+
+  /// Appends the value of placeholder F of @p r to @p out.
+  template<Placeholder F>
+  inline void emitPlaceholder (std::string &out, const Record &r) {
+    if constexpr (F == Placeholder::kIsoTime) {
+      appendIsoSeconds (out, r.timestamp());
+    }
+    else if constexpr (F == Placeholder::kIsoTimeMs) {
+      appendIsoTime (out, r.timestamp(), false);
+    }
+    else if constexpr (F == Placeholder::kEpochMs) {
+      char buf[24];
+      out.append (buf, std::to_chars (buf, buf + sizeof (buf), r.timestamp().count()).ptr);
+    }
+    else if constexpr (F == Placeholder::kSeverity) {
+      out += Logger<>::toCString (r.severity())[0];
+    }
+    else if constexpr (F == Placeholder::kSeverityName) {
+      out += kSeverityNames[static_cast<std::size_t> (r.severity())];
+    }
+    else if constexpr (F == Placeholder::kThread) {
+      char buf[24];
+      out.append (buf, std::to_chars (buf, buf + sizeof (buf), r.thread()).ptr);
+    }
+    else if constexpr (F == Placeholder::kFields) {
+      appendFields (out, r);
+    }
+  }
+}
+/// @endcond
+
+/// @struct DefaultLayout
+/// @brief The layout of the built-in text transports: "<timestamp> <severity>: <message>\n".
+///
+/// The timestamp is UTC in the format "YYYY-MM-DDTHH:MM:SS". Structured fields are written after
+/// the message as " <key>=<value>" pairs.
+struct DefaultLayout {
+  /// @brief Appends "<timestamp> <severity>: " to @p out.
+  /// @param out The output buffer.
+  /// @param r The log record.
+  static void prefix (std::string &out, const Record &r) {
+    char buf[detail::kMaxHeaderSize];
+    out.append (buf, detail::formatHeader (buf, r.severity(), r.timestamp()));
+  }
+
+  /// @brief Appends the structured fields and the line feed to @p out.
+  /// @param out The output buffer.
+  /// @param r The log record.
+  static void suffix (std::string &out, const Record &r) {
+    detail::appendFields (out, r);
+    out += '\n';
+  }
+};
+
+/// @class PatternLayout
+/// @brief A layout described by a pattern which is parsed at compile time.
+///
+/// The pattern is plain text with placeholders between braces:
+/// - `{ts}` or `{ts:iso}`: UTC timestamp in the format "YYYY-MM-DDTHH:MM:SS".
+/// - `{ts:iso_ms}`: UTC timestamp with milliseconds, "YYYY-MM-DDTHH:MM:SS.mmm".
+/// - `{ts:epoch_ms}`: Epoch time in milliseconds.
+/// - `{sev}`: Severity letter (e.g. "I").
+/// - `{sev:name}`: Severity name (e.g. "INFO").
+/// - `{thread}`: Id of the thread which logged the message.
+/// - `{fields}`: The structured fields, as " <key>=<value>" pairs (nothing if there are none).
+/// - `{msg}`: The message. It must appear exactly once.
+///
+/// `{{` and `}}` write a literal brace. Every line ends with a line feed, which the pattern
+/// doesn't include. The pattern is turned into a fixed sequence of steps when the layout is
+/// instantiated, so rendering a line doesn't parse anything and a malformed pattern is a compile
+/// error:
+///
+/// @code
+///   using Layout = cxxlog::PatternLayout<"{ts:iso} [{sev}] {thread} {msg}">;
+///   logger.transport (cxxlog::transport::BasicOutputStream<Layout> { std::cout });
+/// @endcode
+///
+/// @tparam P The pattern.
+template<detail::FixedString P>
+class PatternLayout {
+  public:
+    /// @brief Appends the text of the pattern preceding "{msg}" to @p out.
+    /// @param out The output buffer.
+    /// @param r The log record.
+    static void prefix (std::string &out, const Record &r) {
+      emit<0> (out, r, std::make_index_sequence<kMessage> {});
+    }
+
+    /// @brief Appends the text of the pattern following "{msg}" and the line feed to @p out.
+    /// @param out The output buffer.
+    /// @param r The log record.
+    static void suffix (std::string &out, const Record &r) {
+      emit<kMessage + 1> (out, r, std::make_index_sequence<kSteps.size() - kMessage - 1> {});
+      out += '\n';
+    }
+
+  private:
+    static constexpr auto kSteps { detail::parsePattern<P>() };
+    static constexpr std::size_t kMessage {
+      static_cast<std::size_t> (std::find_if (kSteps.begin(), kSteps.end(), [] (const auto &s) { return s.placeholder == detail::Placeholder::kMessage; }) - kSteps.begin())
+    };
+
+    template<std::size_t I>
+    static void step (std::string &out, const Record &r) {
+      if constexpr (kSteps[I].placeholder == detail::Placeholder::kText)
+        out.append (P.text + kSteps[I].offset, kSteps[I].size);
+      else
+        detail::emitPlaceholder<kSteps[I].placeholder> (out, r);
+    }
+
+    template<std::size_t First, std::size_t... I>
+    static void emit (std::string &out, const Record &r, std::index_sequence<I...>) {
+      (step<First + I> (out, r), ...);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,273 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_LEVEL_SIGNALS_H__
+#define __CXX_LOGGER_LEVEL_SIGNALS_H__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <concepts>
+#include <csignal>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog {
+
+/// @class LevelSignals
+/// @brief Changes the severity level threshold of loggers when the process receives a signal.
+///
+/// While a LevelSignals object exists, `SIGUSR1` lowers the threshold of the watched loggers one
+/// step (e.g. from Severity::kInfo to Severity::kDebug, so more messages are output) and
+/// `SIGUSR2` raises it one step, between Severity::kVerbose and Severity::kNone:
+///
+/// @code
+///   cxxlog::LevelSignals signals {};
+///   signals.watch (logger);
+/// @endcode
+///
+/// @code
+///   kill -USR1 $(pidof app)
+/// @endcode
+///
+/// The signal handler only writes a byte to a non-blocking pipe, which is async-signal-safe. A
+/// background thread blocks on the pipe and applies the steps to the loggers as they arrive, one
+/// at a time and in order, so the signal handler never touches a logger. Without the background
+/// thread, apply() does the same from any thread, e.g. from a main loop polling fd().
+///
+/// Only one LevelSignals object can exist at a time. The watched loggers must outlive it; its
+/// destructor restores the previous signal handlers.
+class LevelSignals {
+  public:
+    /// @brief Constructor for the LevelSignals class. Installs the signal handlers and starts
+    /// the background thread.
+    /// @param lower The signal lowering the thresholds.
+    /// @param raise The signal raising the thresholds.
+    /// @param background Whether a background thread applies the steps; if `false`, they are
+    /// only applied by apply().
+    /// @throws std::logic_error If another LevelSignals object exists.
+    /// @throws std::system_error If the pipe or a signal handler can't be set up, or the thread
+    /// can't be started.
+    LevelSignals (int lower = SIGUSR1, int raise = SIGUSR2, bool background = true):
+      _lower { lower },
+      _raise { raise }
+    {
+      static_assert (std::atomic<int>::is_always_lock_free, "cxxlog: LevelSignals needs lock-free atomics");
+
+      bool expected { false };
+      if (!active().compare_exchange_strong (expected, true))
+        throw std::logic_error { "a LevelSignals object is already installed" };
+
+      if (::pipe2 (_signals.data(), O_NONBLOCK | O_CLOEXEC) < 0 || (background && ::pipe2 (_wake.data(), O_CLOEXEC) < 0)) {
+        const auto error { errno };
+        release (0);
+        throw std::system_error { error, std::generic_category(), "pipe2" };
+      }
+
+      signalFd().store (_signals[1], std::memory_order_relaxed);
+
+      if (!install (_lower, &LevelSignals::onLower, _previousLower)) {
+        const auto error { errno };
+        release (0);
+        throw std::system_error { error, std::generic_category(), "sigaction" };
+      }
+
+      if (!install (_raise, &LevelSignals::onRaise, _previousRaise)) {
+        const auto error { errno };
+        release (1);
+        throw std::system_error { error, std::generic_category(), "sigaction" };
+      }
+
+      if (background) {
+        try {
+          _worker = std::thread { [ this ] () { run(); } };
+        }
+        catch (...) {
+          release (2);
+          throw;
+        }
+      }
+    }
+
+    LevelSignals (const LevelSignals &) = delete;
+    LevelSignals & operator= (const LevelSignals &) = delete;
+
+    /// @brief Destructor for the LevelSignals class. Stops the background thread and restores
+    /// the previous signal handlers.
+    ~LevelSignals () {
+      if (_worker.joinable()) {
+        const char c { 0 };
+        while (::write (_wake[1], &c, 1) < 0 && errno == EINTR) {
+          // retry
+        }
+
+        _worker.join();
+      }
+
+      release (2);
+    }
+
+    /// @brief Changes the level of a logger when the signals are received.
+    /// @tparam L The logger type, with `getLevel()` and `setLevel(Severity)` methods (e.g. Logger).
+    /// @param logger The logger, which must outlive this object.
+    template<typename L>
+    requires requires (L &l, Severity s) { { l.getLevel() } -> std::convertible_to<Severity>; l.setLevel (s); }
+    void watch (L &logger) {
+      const std::lock_guard lock { _mutex };
+      _loggers.push_back ([ &logger ] (int steps) { logger.setLevel (step (logger.getLevel(), steps)); });
+    }
+
+    /// @brief Applies the steps received so far to the watched loggers, one at a time and in the
+    /// order the signals arrived.
+    /// @return The sum of the steps applied: negative if the thresholds were lowered.
+    int apply () {
+      const std::lock_guard lock { _mutex };
+      return applyLocked();
+    }
+
+    /// @brief Gets the file descriptor which is readable while there are steps to apply, to wait
+    /// for the signals in an event loop when there is no background thread.
+    /// @return The file descriptor, owned by this object.
+    int fd () const noexcept { return _signals[0]; }
+
+    /// @brief Moves a severity level threshold by a number of steps, between Severity::kVerbose
+    /// and Severity::kNone.
+    /// @param s The severity level threshold.
+    /// @param steps The number of steps: negative to lower the threshold.
+    /// @return The new severity level threshold.
+    static constexpr Severity step (Severity s, int steps) noexcept {
+      const auto index { s == Severity::kNone ? kSteps - 1 : static_cast<int> (s) };
+      const auto next { std::clamp (index + steps, 0, kSteps - 1) };
+      return next == kSteps - 1 ? Severity::kNone : static_cast<Severity> (next);
+    }
+
+  private:
+    // kVerbose to kFatal, then kNone
+    static constexpr int kSteps { static_cast<int> (Severity::kFatal) + 2 };
+
+    static constexpr char kLowerByte { '-' };
+    static constexpr char kRaiseByte { '+' };
+
+    static std::atomic<bool> & active () noexcept {
+      static std::atomic<bool> installed { false };
+      return installed;
+    }
+
+    // write end of the pipe of the installed object, -1 if none
+    static std::atomic<int> & signalFd () noexcept {
+      static std::atomic<int> fd { -1 };
+      return fd;
+    }
+
+    static void notify (char c) noexcept {
+      const auto saved { errno };
+      const auto fd { signalFd().load (std::memory_order_relaxed) };
+      if (fd >= 0) {
+        // a full pipe drops the step
+        [[maybe_unused]] const auto n { ::write (fd, &c, 1) };
+      }
+      errno = saved;
+    }
+
+    static void onLower (int) { notify (kLowerByte); }
+
+    static void onRaise (int) { notify (kRaiseByte); }
+
+    static bool install (int sig, void (*handler) (int), struct sigaction &previous) noexcept {
+      struct sigaction action {};
+      action.sa_handler = handler;
+      action.sa_flags = SA_RESTART;
+      sigemptyset (&action.sa_mask);
+
+      return ::sigaction (sig, &action, &previous) == 0;
+    }
+
+    // Restores the handlers installed so far, closes the pipes and lets another object install.
+    void release (int installed) noexcept {
+      if (installed > 1)
+        ::sigaction (_raise, &_previousRaise, nullptr);
+      if (installed > 0)
+        ::sigaction (_lower, &_previousLower, nullptr);
+
+      signalFd().store (-1, std::memory_order_relaxed);
+
+      for (auto *fd: { &_signals[0], &_signals[1], &_wake[0], &_wake[1] }) {
+        if (*fd >= 0)
+          ::close (*fd);
+        *fd = -1;
+      }
+
+      active().store (false);
+    }
+
+    int applyLocked () {
+      char buffer[64];
+      int total { 0 };
+
+      for (;;) {
+        const auto n { ::read (_signals[0], buffer, sizeof (buffer)) };
+        if (n < 0 && errno == EINTR)
+          continue;
+        if (n <= 0)
+          break;
+
+        // one step at a time, so each one is clamped: ten raises then a lower end on kFatal
+        for (ssize_t i = 0; i < n; ++i) {
+          const auto steps { buffer[i] == kLowerByte ? -1 : 1 };
+          for (const auto &logger: _loggers)
+            logger (steps);
+          total += steps;
+        }
+      }
+
+      return total;
+    }
+
+    void run () {
+      std::array<pollfd, 2> fds { { { _signals[0], POLLIN, 0 }, { _wake[0], POLLIN, 0 } } };
+
+      for (;;) {
+        if (::poll (fds.data(), fds.size(), -1) < 0) {
+          if (errno == EINTR)
+            continue;
+          return;
+        }
+
+        if (fds[1].revents)
+          return;
+
+        const std::lock_guard lock { _mutex };
+        applyLocked();
+      }
+    }
+
+    int _lower;
+    int _raise;
+    struct sigaction _previousLower {};
+    struct sigaction _previousRaise {};
+    std::array<int, 2> _signals { -1, -1 };
+    std::array<int, 2> _wake { -1, -1 };
+
+    std::mutex _mutex {};
+    std::vector<std::function<void (int)>> _loggers {};
+    std::thread _worker {};
+};
+
+}
+
+#endif
@@ -5,13 +5,36 @@
 // ----------------------------------------------------------------------------
 #ifndef __CXX_LOGGER_H__
 #define __CXX_LOGGER_H__
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
 #include <cinttypes>
+#include <cmath>
+#include <concepts>
+#include <cstring>
+#include <functional>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 #include <variant>
+#include <vector>
+
+#ifdef __linux__
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#else
+  #include <thread>
+#endif
 
 #ifdef CXXLOG_USE_FMT_LIBRARY
   #include <fmt/format.h>
@@ -19,6 +42,8 @@
   #include <format>
 #endif
 
+#include <cxxlog/probes.h>
+
 
 namespace cxxlog {
 
@@ -42,6 +67,460 @@ enum class Severity: std::int_fast8_t {
   kNone = 0x7F     ///< No logging.
 };
 
+/// @brief The value of a structured log field.
+using FieldValue = std::variant<bool, std::int64_t, std::uint64_t, double, std::string>;
+
+/// @struct Field
+/// @brief A typed key-value pair attached to a log message (see kv()).
+struct Field {
+  std::string key {};   ///< Name of the field.
+  FieldValue value {};  ///< Value of the field.
+};
+
+/// @brief Creates a structured log field.
+///
+/// Booleans, integers and floating point numbers keep their type; strings are stored as they are
+/// and any other type is converted to a string with the format library:
+///
+/// @code
+///   logger.info ("request done", cxxlog::kv ("status", 200), cxxlog::kv ("ms", 3.2));
+/// @endcode
+///
+/// @tparam T The type of the value.
+/// @param key The name of the field.
+/// @param value The value of the field.
+/// @return The field.
+template<typename T>
+inline Field kv (std::string key, T &&value) {
+  using V = std::remove_cvref_t<T>;
+
+  if constexpr (std::is_same_v<V, bool>)
+    return { std::move (key), value };
+  else if constexpr (std::is_same_v<V, char>)
+    return { std::move (key), std::string (1, value) };
+  else if constexpr (std::is_integral_v<V> && std::is_signed_v<V>)
+    return { std::move (key), static_cast<std::int64_t> (value) };
+  else if constexpr (std::is_integral_v<V>)
+    return { std::move (key), static_cast<std::uint64_t> (value) };
+  else if constexpr (std::is_floating_point_v<V>)
+    return { std::move (key), static_cast<double> (value) };
+  else if constexpr (std::is_constructible_v<std::string, T>)
+    return { std::move (key), std::string (std::forward<T> (value)) };
+  else
+    return { std::move (key), fmtlib::format ("{}", value) };
+}
+
+/// @cond Doxygen_Suppress
+namespace detail {
+  template<typename T>
+  inline constexpr bool kIsField { std::is_same_v<std::remove_cvref_t<T>, Field> };
+
+  /// Number of leading arguments of a log call which are format arguments rather than fields.
+  template<typename... Args>
+  consteval std::size_t countFormatArgs () {
+    constexpr bool isField[] { false, kIsField<Args>... };
+
+    std::size_t n { 0 };
+    while (n < sizeof... (Args) && !isField[n + 1])
+      ++n;
+
+    return n;
+  }
+
+  /// Whether every field of a log call follows the format arguments.
+  template<typename... Args>
+  inline constexpr bool kFieldsLast { ((kIsField<Args> ? 1 : 0) + ... + 0) == sizeof... (Args) - countFormatArgs<Args...>() };
+
+  template<typename Seq, typename... Args>
+  struct FormatStringOf;
+
+  template<std::size_t... I, typename... Args>
+  struct FormatStringOf<std::index_sequence<I...>, Args...> {
+    using type = fmtlib::format_string<std::tuple_element_t<I, std::tuple<Args...>>...>;
+  };
+
+  /// The format string of a log call: checked against the format arguments only, not the fields.
+  template<typename... Args>
+  using FormatString = typename FormatStringOf<std::make_index_sequence<countFormatArgs<Args...>()>, Args...>::type;
+
+  /// The text of a format string.
+  template<typename F>
+  inline std::string_view formatView (const F &fmt) noexcept {
+    if constexpr (requires { fmt.get(); }) {
+      const auto text { fmt.get() };
+      return { text.data(), text.size() };
+    }
+    else {
+      const fmtlib::basic_string_view<char> text { fmt };
+      return { text.data(), text.size() };
+    }
+  }
+
+  /// One object per layout type; its address identifies the layout inside a Record.
+  template<typename L>
+  inline constexpr char kLayoutTag {};
+
+  /// Identifier of the calling thread: the kernel thread id on Linux, a hash of std::thread::id elsewhere.
+  inline std::uint64_t threadId () noexcept {
+#ifdef __linux__
+    thread_local const auto id { static_cast<std::uint64_t> (::syscall (SYS_gettid)) };
+#else
+    thread_local const auto id { static_cast<std::uint64_t> (std::hash<std::thread::id> {} (std::this_thread::get_id())) };
+#endif
+    return id;
+  }
+
+  /// Next number of a per-thread xorshift64* generator, seeded on first use from the thread id
+  /// and the clock. Fast rather than good: it is only used to sample log calls.
+  inline std::uint64_t random () noexcept {
+    thread_local std::uint64_t state { 0 };
+    if (state == 0) {
+      // splitmix64 of the seed, so close seeds give unrelated sequences
+      auto z { threadId() ^ static_cast<std::uint64_t> (std::chrono::steady_clock::now().time_since_epoch().count()) };
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      state = (z ^ (z >> 31)) | 1;
+    }
+
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dull;
+  }
+
+  /// Per-thread cache of the objects of type T a thread owns in shared states, such as its
+  /// counters in a Metrics object, keyed by the unique id of the state. It holds the last N
+  /// states used, so a thread alternating between a few of them (e.g. two loggers) still finds
+  /// its object without taking the lock of the state. Ids are never reused, so the entries of
+  /// destroyed states never match again.
+  template<typename T, std::size_t N = 8>
+  class ThreadCache {
+    public:
+      static T * find (std::uint64_t id) noexcept {
+        for (const auto &entry: storage().entries) {
+          if (entry.id == id)
+            return entry.value;
+        }
+
+        return nullptr;
+      }
+
+      static void insert (std::uint64_t id, T *value) noexcept {
+        auto &s { storage() };
+        s.entries[s.next++ % N] = { id, value };
+      }
+
+      static void erase (std::uint64_t id) noexcept {
+        for (auto &entry: storage().entries) {
+          if (entry.id == id)
+            entry = { 0, nullptr };
+        }
+      }
+
+    private:
+      struct Entry {
+        std::uint64_t id;
+        T *value;
+      };
+
+      struct Storage {
+        std::array<Entry, N> entries {};
+        std::size_t next { 0 };
+      };
+
+      static Storage & storage () noexcept {
+        thread_local Storage s {};
+        return s;
+      }
+  };
+}
+/// @endcond
+
+/// @class Record
+/// @brief An immutable log record shared by all the transports of a Logger.
+///
+/// A Record holds the formatted message, its severity level, its timestamp, the id of the thread
+/// which logged it and its structured fields, together with the
+/// text that each layout used by the logger transports puts around the message (e.g. the
+/// "<timestamp> <severity>: " prefix and the line feed of the default layout). The Logger creates
+/// one Record per log call and renders each distinct layout once, so transports sharing a layout
+/// don't format the same header again.
+///
+/// Records are reference counted: copying a Record is cheap and shares the same immutable buffer,
+/// which lets asynchronous transports keep it without copying the message.
+class Record {
+  public:
+    /// @brief The text a layout puts before and after the message.
+    struct Parts {
+      std::string_view prefix {}; ///< Text preceding the message.
+      std::string_view suffix {}; ///< Text following the message.
+    };
+
+    class View;
+
+    /// @brief Default constructor. Creates an empty record which must not be accessed.
+    Record () noexcept = default;
+
+    /// @brief Constructor for the Record class. The record belongs to the calling thread.
+    /// @param msg The formatted message.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    /// @param fields The structured fields of the message.
+    Record (std::string msg, Severity s, std::chrono::milliseconds ts, std::vector<Field> fields = {}):
+      _data { std::make_shared<Data> (std::move (msg), s, ts, std::move (fields)) }
+    {
+      // empty
+    }
+
+    /// @brief Constructor for the Record class, for records logged by another thread (e.g. when
+    /// they are replayed from a buffer).
+    /// @param msg The formatted message.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    /// @param fields The structured fields of the message.
+    /// @param thread The id of the thread which logged the message.
+    Record (std::string msg, Severity s, std::chrono::milliseconds ts, std::vector<Field> fields, std::uint64_t thread):
+      Record { std::move (msg), s, ts, std::move (fields) }
+    {
+      _data->thread = thread;
+    }
+
+    /// @brief Creates a record with the text of the given layouts already rendered.
+    ///
+    /// `void` entries and repeated layouts are skipped.
+    ///
+    /// @tparam Ls The layouts to render.
+    /// @param msg The formatted message.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    /// @param fields The structured fields of the message.
+    /// @return The new record.
+    template<typename... Ls>
+    static Record make (std::string msg, Severity s, std::chrono::milliseconds ts, std::vector<Field> fields = {}) {
+      Record record { std::move (msg), s, ts, std::move (fields) };
+      if constexpr (((!std::is_void_v<Ls>) || ...)) {
+        thread_local std::string scratch {};
+        scratch.clear();
+        (record.render<Ls> (scratch), ...);
+        record._data->store (scratch);
+      }
+
+      return record;
+    }
+
+    /// @brief Checks whether the record holds a message.
+    /// @return `false` for default constructed and moved-from records.
+    explicit operator bool () const noexcept { return static_cast<bool> (_data); }
+
+    /// @brief Gets the severity level of the record.
+    /// @return The severity level.
+    Severity severity () const noexcept { return _data->severity; }
+
+    /// @brief Gets the timestamp of the record.
+    /// @return Epoch time in milliseconds.
+    std::chrono::milliseconds timestamp () const noexcept { return _data->ts; }
+
+    /// @brief Gets the id of the thread which created the record.
+    /// @return The thread id (the kernel thread id on Linux).
+    std::uint64_t thread () const noexcept { return _data->thread; }
+
+    /// @brief Gets the formatted message of the record.
+    /// @return The message.
+    const std::string & message () const noexcept { return *_data->text; }
+
+    /// @brief Gets the structured fields of the record, in the order they were given.
+    /// @return The fields.
+    std::span<const Field> fields () const noexcept { return _data->fields; }
+
+    /// @brief Checks whether the text of layout L was rendered when the record was created.
+    /// @tparam L The layout type.
+    /// @return `true` if the text is shared, `false` if parts() has to render it.
+    template<typename L>
+    bool rendered () const noexcept { return _data->find (&detail::kLayoutTag<L>) != nullptr; }
+
+    /// @brief Gets the text layout L puts around the message.
+    ///
+    /// Returns the text rendered when the record was created if available; otherwise the text
+    /// is rendered into @p scratch, which must outlive the returned views.
+    ///
+    /// @tparam L The layout type.
+    /// @param scratch Buffer used when the layout text wasn't rendered in advance.
+    /// @return The prefix and suffix of the message.
+    template<typename L>
+    Parts parts (std::string &scratch) const {
+      if (const auto *slot { _data->find (&detail::kLayoutTag<L>) })
+        return { _data->view (slot->prefixOffset, slot->prefixSize), _data->view (slot->prefixOffset + slot->prefixSize, slot->suffixSize) };
+
+      scratch.clear();
+      L::prefix (scratch, *this);
+      const auto prefixSize { scratch.size() };
+      L::suffix (scratch, *this);
+
+      const std::string_view text { scratch };
+      return { text.substr (0, prefixSize), text.substr (prefixSize) };
+    }
+
+  private:
+    static constexpr std::size_t kMaxLayouts { 4 };
+    static constexpr std::size_t kInlineText { 96 };
+
+    struct Slot {
+      const void *id { nullptr };
+      std::uint32_t prefixOffset { 0 };
+      std::uint32_t prefixSize { 0 };
+      std::uint32_t suffixSize { 0 };
+    };
+
+    struct Data {
+      Data (std::string &&msg, Severity s, std::chrono::milliseconds t, std::vector<Field> &&f):
+        message { std::move (msg) }, severity { s }, ts { t }, thread { detail::threadId() }, fields { std::move (f) }
+      {
+        // empty
+      }
+
+      Data (const std::string &msg, Severity s, std::chrono::milliseconds t) noexcept:
+        text { &msg }, severity { s }, ts { t }, thread { detail::threadId() }
+      {
+        // empty
+      }
+
+      const Slot * find (const void *id) const noexcept {
+        for (std::size_t i = 0; i < count; ++i) {
+          if (slots[i].id == id)
+            return &slots[i];
+        }
+
+        return nullptr;
+      }
+
+      std::string_view view (std::size_t offset, std::size_t size) const noexcept {
+        return { (heapText.empty() ? inlineText : heapText.data()) + offset, size };
+      }
+
+      void store (const std::string &text) {
+        if (text.size() <= kInlineText)
+          std::memcpy (inlineText, text.data(), text.size());
+        else
+          heapText = text;
+      }
+
+      std::string message {};
+      const std::string *text { &message };
+      Severity severity;
+      std::chrono::milliseconds ts;
+      std::uint64_t thread;
+      std::vector<Field> fields;
+      std::array<Slot, kMaxLayouts> slots {};
+      std::size_t count { 0 };
+      std::string heapText {};
+      char inlineText[kInlineText];
+    };
+
+    template<typename L>
+    void render (std::string &text) {
+      if constexpr (!std::is_void_v<L>) {
+        if (_data->count == kMaxLayouts || rendered<L>())
+          return;
+
+        auto &slot { _data->slots[_data->count] };
+        slot.prefixOffset = static_cast<std::uint32_t> (text.size());
+        L::prefix (text, *this);
+        slot.prefixSize = static_cast<std::uint32_t> (text.size() - slot.prefixOffset);
+        L::suffix (text, *this);
+        slot.suffixSize = static_cast<std::uint32_t> (text.size() - slot.prefixOffset - slot.prefixSize);
+
+        // published last so rendered<L>() is false while the layout is being rendered
+        slot.id = &detail::kLayoutTag<L>;
+        ++_data->count;
+      }
+    }
+
+    std::shared_ptr<Data> _data {};
+};
+
+/// @class Record::View
+/// @brief A Record borrowing a message owned by the caller.
+///
+/// Transports use it to write a message logged directly through them with the code path of
+/// the records created by a Logger, without allocating the record or copying the message. The
+/// view must not outlive the message, and the Record it exposes must not be kept after the
+/// call it is passed to.
+class Record::View {
+  public:
+    /// @brief Constructor for the View class. The record belongs to the calling thread.
+    /// @param msg The formatted message, which must outlive the view.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    View (const std::string &msg, Severity s, std::chrono::milliseconds ts) noexcept:
+      _data { msg, s, ts }, _record {}
+    {
+      // a shared_ptr which owns nothing: the data lives as long as the view
+      _record._data = std::shared_ptr<Data> { std::shared_ptr<Data> {}, &_data };
+    }
+
+    View (const View &) = delete;
+    View & operator= (const View &) = delete;
+
+    /// @brief Gets the borrowing record.
+    /// @return The record, valid while the view is.
+    operator const Record & () const noexcept { return _record; }
+
+  private:
+    Data _data;
+    Record _record;
+};
+
+/// @concept Layout
+///
+/// @brief A concept that represents types describing the text written around a log message.
+///
+/// @tparam L The type to be checked for Layout concept compliance.
+///
+/// @requirements
+/// - static L::prefix(std::string &out, const Record &) Appends the text preceding the message to out.
+/// - static L::suffix(std::string &out, const Record &) Appends the text following the message to out.
+template<typename L>
+concept Layout = requires (std::string &out, const Record &record) {
+  L::prefix (out, record);
+  L::suffix (out, record);
+};
+
+/// @concept RecordLoggable
+///
+/// @brief A concept that represents transports which receive the whole shared Record.
+///
+/// A RecordLoggable transport can keep the record (e.g. in a queue) without copying the message
+/// and can declare the layout it writes through a `layout_type` member type, so the Logger renders
+/// that layout once for all the transports using it.
+///
+/// @tparam T The type to be checked for RecordLoggable concept compliance.
+///
+/// @requirements
+/// - T::log(const Record &) const  RecordLoggable types must have a log method with this signature.
+template<typename T>
+concept RecordLoggable = requires (const T l, const Record &record) {
+  l.log (record);
+};
+
+/// @concept Capturing
+///
+/// @brief A concept that represents transports which also capture the log calls below the
+/// Logger severity threshold.
+///
+/// For the log calls the Logger is enabled for, a Capturing transport receives the Record like
+/// any other transport. For the other calls, the Logger doesn't format the message: it passes the
+/// format string and the arguments to the `capture` method instead, so the transport can keep
+/// them and format the message later, only if it is needed (e.g. a flight recorder).
+///
+/// @tparam T The type to be checked for Capturing concept compliance.
+///
+/// @requirements
+/// - static constexpr bool T::kCaptureAll = true
+/// - template<typename... Args> T::capture(Severity, std::chrono::milliseconds, std::string_view fmt, const Args &...) const
+///   Receives a log call below the Logger threshold. Args are the format arguments followed by
+///   the structured fields, if any.
+template<typename T>
+concept Capturing = requires { { T::kCaptureAll } -> std::convertible_to<bool>; } && T::kCaptureAll;
 
 /// @concept Loggable
 ///
@@ -49,17 +528,350 @@ enum class Severity: std::int_fast8_t {
 ///
 /// The Loggable concept defines the requirements for a type that can be used to log messages.
 /// A Loggable type must provide a log method that takes a message (as a const std::string&)
-/// and a severity level.
+/// and a severity level, or a log method that takes a Record (see RecordLoggable).
 ///
 /// @tparam T The type to be checked for Loggable concept compliance.
 ///
 /// @requirements
 /// - T::log(const std::string &, Severity, std::chrono::milliseconds) const  Loggable types must have a log method with this signature.
 template<typename T>
-concept Loggable = requires (T l, const std::string &msg, Severity severity, std::chrono::milliseconds ts) {
+concept Loggable = RecordLoggable<T> || requires (T l, const std::string &msg, Severity severity, std::chrono::milliseconds ts) {
   l.log (msg, severity, ts);
 };
 
+/// @cond Doxygen_Suppress
+namespace detail {
+  /// The layout declared by a transport, or void.
+  template<typename T>
+  struct LayoutOf { using type = void; };
+
+  template<typename T>
+    requires requires { typename T::layout_type; }
+  struct LayoutOf<T> { using type = typename T::layout_type; };
+
+  /// Base class exposing the layout_type of T, if any (used by transport wrappers).
+  template<typename T>
+  struct LayoutTraits {};
+
+  template<typename T>
+    requires requires { typename T::layout_type; }
+  struct LayoutTraits<T> { using layout_type = typename T::layout_type; };
+
+  /// Passes a record to a transport through the best log method it provides.
+  template<Loggable T>
+  inline void deliver (const T &t, const Record &record) {
+    if constexpr (RecordLoggable<T>)
+      t.log (record);
+    else
+      t.log (record.message(), record.severity(), record.timestamp());
+  }
+}
+/// @endcond
+
+template<Loggable... Ts>
+class Logger;
+
+/// @class Metrics
+/// @brief Counters of the load of a Logger.
+///
+/// Attached to a Logger with Logger::metrics(), it counts the messages logged per severity
+/// level and, for every transport, the log calls, the bytes of text passed to it and the time
+/// spent in it, both in total and as a latency histogram. The transports which discard or queue messages are also asked, when a snapshot
+/// is taken, for the number of dropped messages (`dropped()`) and the highest queue depth
+/// (`highWater()`), as an Async wrapper provides. A transport whose copies share their state
+/// provides `probe()` instead, returning a function which fills the TransportStats from a weak
+/// reference to the state, so the Metrics object doesn't keep the transport alive:
+///
+/// @code
+///   const cxxlog::Metrics metrics {};
+///   logger.metrics (metrics);
+///   ...
+///   const auto snapshot { metrics.snapshot() };
+///   if (snapshot.messages[static_cast<std::size_t> (Severity::kError)] > limit) { ... }
+/// @endcode
+///
+/// Each thread updates its own counters, padded to a cache line, without atomic
+/// read-modify-write operations; snapshot() adds them up. The counters of a thread are kept
+/// until the last copy of the Metrics object is destroyed. Only the messages the Logger is
+/// enabled for are counted, and only the first kMaxTransports transports of a Logger.
+///
+/// Copies of a Metrics object share the same counters.
+class Metrics {
+  public:
+    /// Maximum number of transports counted.
+    static constexpr std::size_t kMaxTransports { 16 };
+
+    /// @class Histogram
+    /// @brief Log-linear histogram of the time spent in the log calls of a transport.
+    ///
+    /// Every power of two of nanoseconds is split in 8 linear buckets, so a bucket is at most
+    /// 12.5% wider than its lower bound, from 1 ns up to about 18 minutes (longer calls are
+    /// counted in the last bucket).
+    class Histogram {
+      public:
+        /// Number of linear buckets per power of two.
+        static constexpr std::size_t kSubBuckets { 8 };
+
+        /// Largest power of two of nanoseconds split in buckets.
+        static constexpr std::size_t kMaxExponent { 40 };
+
+        /// Number of buckets.
+        static constexpr std::size_t kBuckets { kSubBuckets + (kMaxExponent - 2) * kSubBuckets };
+
+        /// @brief Gets the bucket of a duration.
+        /// @param ns The duration in nanoseconds.
+        /// @return The bucket index.
+        static constexpr std::size_t bucket (std::uint64_t ns) noexcept {
+          if (ns < kSubBuckets)
+            return static_cast<std::size_t> (ns);
+
+          const auto exponent { static_cast<std::size_t> (std::bit_width (ns) - 1) };
+          if (exponent > kMaxExponent)
+            return kBuckets - 1;
+
+          const auto sub { static_cast<std::size_t> (ns >> (exponent - 3)) & (kSubBuckets - 1) };
+          return kSubBuckets + (exponent - 3) * kSubBuckets + sub;
+        }
+
+        /// @brief Gets the smallest duration counted in a bucket.
+        /// @param index The bucket index.
+        /// @return The lower bound of the bucket.
+        static constexpr std::chrono::nanoseconds lower (std::size_t index) noexcept {
+          if (index < kSubBuckets)
+            return std::chrono::nanoseconds { index };
+
+          const auto exponent { (index - kSubBuckets) / kSubBuckets + 3 };
+          const auto sub { (index - kSubBuckets) % kSubBuckets };
+          return std::chrono::nanoseconds { static_cast<std::int64_t> ((kSubBuckets + sub) << (exponent - 3)) };
+        }
+
+        /// @brief Gets the largest duration counted in a bucket (but the last one).
+        /// @param index The bucket index.
+        /// @return The upper bound of the bucket.
+        static constexpr std::chrono::nanoseconds upper (std::size_t index) noexcept {
+          return index + 1 < kBuckets ? lower (index + 1) - std::chrono::nanoseconds { 1 } : lower (index);
+        }
+
+        /// @brief Gets the count of every bucket.
+        /// @return The counts, indexed by bucket.
+        std::span<const std::uint64_t> buckets () const noexcept { return _buckets; }
+
+        /// @brief Gets the number of timed calls.
+        /// @return The sum of the bucket counts.
+        std::uint64_t count () const noexcept {
+          std::uint64_t n { 0 };
+          for (const auto b: _buckets)
+            n += b;
+          return n;
+        }
+
+        /// @brief Gets an upper bound of a percentile of the durations.
+        /// @param p The percentile, from 0 to 100.
+        /// @return The upper bound of the bucket holding the percentile, or 0 if nothing was timed.
+        std::chrono::nanoseconds percentile (double p) const noexcept {
+          const auto total { count() };
+          if (total == 0)
+            return {};
+
+          const auto rank { std::max<std::uint64_t> (1, static_cast<std::uint64_t> (std::ceil (std::clamp (p, 0.0, 100.0) / 100.0 * static_cast<double> (total)))) };
+
+          std::uint64_t seen { 0 };
+          for (std::size_t i = 0; i < kBuckets; ++i) {
+            seen += _buckets[i];
+            if (seen >= rank)
+              return upper (i);
+          }
+
+          return upper (kBuckets - 1);
+        }
+
+        /// @brief Adds calls to a bucket.
+        /// @param index The bucket index.
+        /// @param n The number of calls.
+        void add (std::size_t index, std::uint64_t n) noexcept { _buckets[index] += n; }
+
+      private:
+        std::array<std::uint64_t, kBuckets> _buckets {};
+    };
+
+    /// @brief Counters of one transport.
+    struct TransportStats {
+      std::uint64_t calls {};           ///< Log calls passed to the transport.
+      std::uint64_t bytes {};           ///< Bytes of the messages, plus the text of the transport layout when the Logger rendered it.
+      std::chrono::nanoseconds time {}; ///< Time spent in the log calls of the transport.
+      std::uint64_t dropped {};         ///< Messages the transport discarded, if it reports them.
+      std::uint64_t highWater {};       ///< Highest number of messages queued by the transport, if it reports it.
+      Histogram latency {};             ///< Distribution of the time spent in each log call.
+    };
+
+    /// @brief Counters at the time of a snapshot() call.
+    struct Snapshot {
+      std::array<std::uint64_t, 6> messages {}; ///< Messages logged per severity level.
+      std::vector<TransportStats> transports {}; ///< Per transport, in the order they were added.
+
+      /// @brief Gets the number of messages discarded by all the transports.
+      /// @return The number of dropped messages.
+      std::uint64_t dropped () const noexcept {
+        std::uint64_t n { 0 };
+        for (const auto &t: transports)
+          n += t.dropped;
+        return n;
+      }
+    };
+
+    /// @brief Constructor for the Metrics class. All the counters start at zero.
+    Metrics (): _state { std::make_shared<State>() } {
+      // empty
+    }
+
+    /// @brief Adds up the counters of every thread.
+    /// @return The current counters.
+    Snapshot snapshot () const {
+      Snapshot snapshot {};
+
+      const std::lock_guard lock { _state->mutex };
+      snapshot.transports.resize (_state->transports);
+
+      for (const auto &[ thread, c ]: _state->counters) {
+        for (std::size_t i = 0; i < snapshot.messages.size(); ++i)
+          snapshot.messages[i] += c->messages[i].load (std::memory_order_relaxed);
+
+        for (std::size_t i = 0; i < snapshot.transports.size(); ++i) {
+          auto &t { snapshot.transports[i] };
+          t.calls += c->calls[i].load (std::memory_order_relaxed);
+          t.bytes += c->bytes[i].load (std::memory_order_relaxed);
+          t.time += std::chrono::nanoseconds { c->nanos[i].load (std::memory_order_relaxed) };
+
+          if (const auto *latency { c->latency[i].load (std::memory_order_acquire) }) {
+            for (std::size_t b = 0; b < Histogram::kBuckets; ++b)
+              t.latency.add (b, (*latency)[b].load (std::memory_order_relaxed));
+          }
+        }
+      }
+
+      for (std::size_t i = 0; i < _state->probes.size(); ++i) {
+        if (_state->probes[i])
+          _state->probes[i] (snapshot.transports[i]);
+      }
+
+      return snapshot;
+    }
+
+  private:
+    template<Loggable... Ts>
+    friend class Logger;
+
+    using Buckets = std::array<std::atomic<std::uint64_t>, Histogram::kBuckets>;
+
+    struct alignas (64) Counters {
+      Counters () = default;
+      Counters (const Counters &) = delete;
+      Counters & operator= (const Counters &) = delete;
+
+      ~Counters () {
+        for (auto &l: latency)
+          delete l.load (std::memory_order_relaxed);
+      }
+
+      std::array<std::atomic<std::uint64_t>, 6> messages {};
+      std::array<std::atomic<std::uint64_t>, kMaxTransports> calls {};
+      std::array<std::atomic<std::uint64_t>, kMaxTransports> bytes {};
+      std::array<std::atomic<std::uint64_t>, kMaxTransports> nanos {};
+
+      // allocated by the owning thread when it first times the transport
+      std::array<std::atomic<Buckets *>, kMaxTransports> latency {};
+    };
+
+    struct State {
+      // The counters of the calling thread, with a per-thread cache of the last states used.
+      Counters & local () {
+        if (auto *cached { detail::ThreadCache<Counters>::find (id) })
+          return *cached;
+
+        const std::lock_guard lock { mutex };
+        auto &c { counters[detail::threadId()] };
+        if (!c)
+          c = std::make_unique<Counters>();
+
+        detail::ThreadCache<Counters>::insert (id, c.get());
+        return *c;
+      }
+
+      // identifies the state in the thread caches, where its address could be reused
+      static std::uint64_t nextId () noexcept {
+        static std::atomic<std::uint64_t> counter { 0 };
+        return counter.fetch_add (1, std::memory_order_relaxed) + 1;
+      }
+
+      const std::uint64_t id { nextId() };
+
+      std::mutex mutex {};
+      std::map<std::uint64_t, std::unique_ptr<Counters>> counters {};
+      std::size_t transports { 0 };
+      std::vector<std::function<void (TransportStats &)>> probes {};
+    };
+
+    // Only the thread owning the counters writes them.
+    static void add (std::atomic<std::uint64_t> &counter, std::uint64_t n) noexcept {
+      counter.store (counter.load (std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Counts a call to the transport at position index, which took ns nanoseconds.
+    static void time (Counters &counters, std::size_t index, std::uint64_t ns) {
+      add (counters.nanos[index], ns);
+
+      auto *latency { counters.latency[index].load (std::memory_order_relaxed) };
+      if (!latency) {
+        latency = new Buckets {};
+        counters.latency[index].store (latency, std::memory_order_release);
+      }
+
+      add ((*latency)[Histogram::bucket (ns)], 1);
+    }
+
+    // The bytes of text passed to a transport of type T.
+    template<typename T>
+    static std::size_t size (const Record &record) noexcept {
+      using L = typename detail::LayoutOf<T>::type;
+
+      if constexpr (!std::is_void_v<L>) {
+        if (record.rendered<L>()) {
+          std::string scratch {};
+          const auto parts { record.parts<L> (scratch) };
+          return parts.prefix.size() + record.message().size() + parts.suffix.size();
+        }
+      }
+
+      return record.message().size();
+    }
+
+    // Registers the transport at position index of a Logger.
+    template<typename T>
+    void watch (std::size_t index, const T &t) const {
+      if (index >= kMaxTransports)
+        return;
+
+      const std::lock_guard lock { _state->mutex };
+      _state->transports = std::max (_state->transports, index + 1);
+
+      if constexpr (requires { { t.probe() } -> std::convertible_to<std::function<void (TransportStats &)>>; }) {
+        _state->probes.resize (std::max (_state->probes.size(), index + 1));
+        _state->probes[index] = t.probe();
+      }
+      else if constexpr (requires { t.dropped(); } || requires { t.highWater(); }) {
+        _state->probes.resize (std::max (_state->probes.size(), index + 1));
+        _state->probes[index] = [ t ] (TransportStats &stats) {
+          if constexpr (requires { t.dropped(); })
+            stats.dropped = static_cast<std::uint64_t> (t.dropped());
+          if constexpr (requires { t.highWater(); })
+            stats.highWater = static_cast<std::uint64_t> (t.highWater());
+        };
+      }
+    }
+
+    std::shared_ptr<State> _state;
+};
+
 /// @brief A logger class for handling and formatting log messages with different severity levels.
 ///
 /// The Logger class provides functionality to log messages of various severity levels, such as
@@ -76,6 +888,48 @@ class Logger {
       // empty
     }
 
+    /// @brief Copy constructor for the Logger class.
+    /// @param other The logger to copy the transports, metrics and level from.
+    Logger (const Logger &other):
+      _transport { other._transport },
+      _metrics { other._metrics },
+      _severity { other.getLevel() }
+    {
+      copySampling (other);
+    }
+
+    /// @brief Copy assignment operator for the Logger class.
+    /// @param other The logger to copy the transports, metrics and level from.
+    /// @return A reference to this logger.
+    Logger & operator= (const Logger &other) {
+      _transport = other._transport;
+      _metrics = other._metrics;
+      setLevel (other.getLevel());
+      copySampling (other);
+      return *this;
+    }
+
+    /// @brief Move constructor for the Logger class.
+    /// @param other The logger to move the transports and metrics from, and to copy the level from.
+    Logger (Logger &&other) noexcept:
+      _transport { std::move (other._transport) },
+      _metrics { std::move (other._metrics) },
+      _severity { other.getLevel() }
+    {
+      copySampling (other);
+    }
+
+    /// @brief Move assignment operator for the Logger class.
+    /// @param other The logger to move the transports and metrics from, and to copy the level from.
+    /// @return A reference to this logger.
+    Logger & operator= (Logger &&other) noexcept {
+      _transport = std::move (other._transport);
+      _metrics = std::move (other._metrics);
+      setLevel (other.getLevel());
+      copySampling (other);
+      return *this;
+    }
+
     /// @brief Add a new logger transport.
     ///
     ///  A transport is essentially a class which will handle what to do with the logs,
@@ -86,6 +940,23 @@ class Logger {
     template<Loggable T>
     inline void transport (T &&t) const {
       _transport.emplace_back (std::forward<T> (t));
+
+      if (_metrics)
+        std::visit ([ this ] (const auto &t) { _metrics->watch (_transport.size() - 1, t); }, _transport.back());
+    }
+
+    /// @brief Attaches the counters of the logger load.
+    ///
+    /// Once attached, every log call the logger is enabled for updates the counters of the
+    /// calling thread, and every transport call is timed. See Metrics.
+    ///
+    /// @param m The counters to update. Copies of a Metrics object share them.
+    inline void metrics (const Metrics &m) const {
+      _metrics = m;
+
+      std::size_t index { 0 };
+      for (const auto &t: _transport)
+        std::visit ([ this, &index ] (const auto &t) { _metrics->watch (index++, t); }, t);
     }
 
     /// @brief Logs a message.
@@ -93,20 +964,100 @@ class Logger {
     /// This method is used to log a message for the specified verbosity level. The message
     /// will be output only if the logger is enabled for the specified severity level.
     ///
+    /// The format arguments can be followed by structured fields created with kv(), which are
+    /// passed to the transports as typed values instead of being formatted into the message.
+    /// Transports which only provide the `log (msg, severity, ts)` method receive the message
+    /// without the fields.
+    ///
     /// @tparam Args Variadic template parameter for the arguments to format the log message.
     /// @param s The severity level of the message.
     /// @param fmt The format string for the log message.
-    /// @param args The arguments to be inserted into the format string.
+    /// @param args The arguments to be inserted into the format string, then the fields.
     template<typename... Args>
-    inline void log (Severity s, fmtlib::format_string<Args...> fmt, Args && ... args) const {
-      if (isEnabled (s)) {
-          const auto msg { fmtlib::format (fmt, std::forward<Args>(args)...) };
+    inline void log (Severity s, detail::FormatString<Args...> fmt, Args && ... args) const {
+      logIf (isEnabled (s), s, fmt, std::forward<Args>(args)...);
+    }
+
+    /// @brief Logs a message whose severity level was checked by the caller.
+    ///
+    /// Like log(), but the caller decides whether the message is output instead of the logger
+    /// threshold (e.g. a named logger of a Registry, which has its own level). When @p enabled
+    /// is `false`, or when the call is sampled out (see setSampleRate()), the message is only
+    /// passed to the Capturing transports.
+    ///
+    /// @tparam Args Variadic template parameter for the arguments to format the log message.
+    /// @param enabled Whether the message is output.
+    /// @param s The severity level of the message.
+    /// @param fmt The format string for the log message.
+    /// @param args The arguments to be inserted into the format string, then the fields.
+    template<typename... Args>
+    inline void logIf (bool enabled, Severity s, detail::FormatString<Args...> fmt, Args && ... args) const {
+      static_assert (detail::kFieldsLast<Args...>, "cxxlog: structured fields must follow the format arguments");
+
+      auto threshold { kKeepAll };
+      if (enabled) {
+        threshold = sampling (s);
+        enabled = threshold == kKeepAll || detail::random() < threshold;
+      }
+
+      CXXLOG_PROBE2 (enabled, static_cast<int> (s), enabled ? 1 : 0);
+
+      if (enabled) {
+          constexpr auto kFormatArgs { detail::countFormatArgs<Args...>() };
+          std::string msg {};
+          std::vector<Field> fields {};
+
+          CXXLOG_PROBE1 (format_start, static_cast<int> (s));
+
+          if constexpr (kFormatArgs == sizeof... (Args)) {
+            msg = fmtlib::format (fmt, std::forward<Args>(args)...);
+          }
+          else {
+            auto tuple { std::forward_as_tuple (std::forward<Args>(args)...) };
+            [ & ]<std::size_t... I, std::size_t... F> (std::index_sequence<I...>, std::index_sequence<F...>) {
+              msg = fmtlib::format (fmt, std::get<I> (std::move (tuple))...);
+              fields.reserve (sizeof... (F));
+              (fields.push_back (std::get<kFormatArgs + F> (std::move (tuple))), ...);
+            } (std::make_index_sequence<kFormatArgs> {}, std::make_index_sequence<sizeof... (Args) - kFormatArgs> {});
+          }
+
+          CXXLOG_PROBE2 (format_end, static_cast<int> (s), msg.size());
+
+          if (threshold != kKeepAll)
+            fields.push_back ({ std::string { kSampleRateField }, static_cast<double> (threshold) * 0x1p-64 });
+
           const auto ts { std::chrono::duration_cast<std::chrono::milliseconds> (
             std::chrono::system_clock::now().time_since_epoch()
           ) };
 
-          for (const auto &t: _transport)
-            std::visit ([ &msg, s, ts ] (const auto &t) { t.log (msg, s, ts); }, t);
+          if constexpr ((RecordLoggable<Ts> || ...)) {
+            // format once: every transport shares the record and the layouts rendered for it
+            const auto record { Record::make<typename detail::LayoutOf<Ts>::type...> (std::move (msg), s, ts, std::move (fields)) };
+
+            dispatch (s,
+              [ &record ] (const auto &t) { detail::deliver (t, record); },
+              [ &record ] (const auto &t) { return Metrics::size<std::decay_t<decltype (t)>> (record); }
+            );
+          }
+          else {
+            dispatch (s,
+              [ &msg, s, ts ] (const auto &t) { t.log (msg, s, ts); },
+              [ &msg ] (const auto &) { return msg.size(); }
+            );
+          }
+      }
+      else if constexpr ((Capturing<Ts> || ...)) {
+        // the message isn't formatted: capturing transports get the arguments
+        const auto ts { std::chrono::duration_cast<std::chrono::milliseconds> (
+          std::chrono::system_clock::now().time_since_epoch()
+        ) };
+
+        for (const auto &t: _transport) {
+          std::visit ([ & ] (const auto &t) {
+            if constexpr (Capturing<std::decay_t<decltype (t)>>)
+              t.capture (s, ts, detail::formatView (fmt), args...);
+          }, t);
+        }
       }
     }
 
@@ -117,9 +1068,9 @@ class Logger {
     ///
     /// @tparam Args Variadic template parameter for the arguments to format the log message.
     /// @param fmt The format string for the log message.
-    /// @param args The arguments to be inserted into the format string.
+    /// @param args The arguments to be inserted into the format string, then the fields.
     template<typename... Args>
-    inline void verbose (fmtlib::format_string<Args...> fmt, Args && ... args) const {
+    inline void verbose (detail::FormatString<Args...> fmt, Args && ... args) const {
       log (Severity::kVerbose, fmt, std::forward<Args>(args)...);
     }
 
@@ -130,9 +1081,9 @@ class Logger {
     ///
     /// @tparam Args Variadic template parameter for the arguments to format the log message.
     /// @param fmt The format string for the log message.
-    /// @param args The arguments to be inserted into the format string.
+    /// @param args The arguments to be inserted into the format string, then the fields.
     template<typename... Args>
-    inline void debug (fmtlib::format_string<Args...> fmt, Args && ... args) const {
+    inline void debug (detail::FormatString<Args...> fmt, Args && ... args) const {
       log (Severity::kDebug, fmt, std::forward<Args>(args)...);
     }
 
@@ -143,9 +1094,9 @@ class Logger {
     ///
     /// @tparam Args Variadic template parameter for the arguments to format the log message.
     /// @param fmt The format string for the log message.
-    /// @param args The arguments to be inserted into the format string.
+    /// @param args The arguments to be inserted into the format string, then the fields.
     template<typename... Args>
-    inline void info (fmtlib::format_string<Args...> fmt, Args && ... args) const {
+    inline void info (detail::FormatString<Args...> fmt, Args && ... args) const {
       log (Severity::kInfo, fmt, std::forward<Args>(args)...);
     }
 
@@ -156,9 +1107,9 @@ class Logger {
     ///
     /// @tparam Args Variadic template parameter for the arguments to format the log message.
     /// @param fmt The format string for the log message.
-    /// @param args The arguments to be inserted into the format string.
+    /// @param args The arguments to be inserted into the format string, then the fields.
     template<typename... Args>
-    inline void warn (fmtlib::format_string<Args...> fmt, Args && ... args) const {
+    inline void warn (detail::FormatString<Args...> fmt, Args && ... args) const {
       log (Severity::kWarn, fmt, std::forward<Args>(args)...);
     }
 
@@ -169,9 +1120,9 @@ class Logger {
     ///
     /// @tparam Args Variadic template parameter for the arguments to format the log message.
     /// @param fmt The format string for the log message.
-    /// @param args The arguments to be inserted into the format string.
+    /// @param args The arguments to be inserted into the format string, then the fields.
     template<typename... Args>
-    inline void error (fmtlib::format_string<Args...> fmt, Args && ... args) const {
+    inline void error (detail::FormatString<Args...> fmt, Args && ... args) const {
       log (Severity::kError, fmt, std::forward<Args>(args)...);
     }
 
@@ -182,37 +1133,134 @@ class Logger {
     ///
     /// @tparam Args Variadic template parameter for the arguments to format the log message.
     /// @param fmt The format string for the log message.
-    /// @param args The arguments to be inserted into the format string.
+    /// @param args The arguments to be inserted into the format string, then the fields.
     template<typename... Args>
-    inline void fatal (fmtlib::format_string<Args...> fmt, Args && ... args) const {
+    inline void fatal (detail::FormatString<Args...> fmt, Args && ... args) const {
       log (Severity::kFatal, fmt, std::forward<Args>(args)...);
     }
 
+    /// @brief Flushes the logger transports.
+    ///
+    /// Calls the `flush()` method of every transport which provides one, such as the transports
+    /// which buffer log messages before writing them. Other transports are left untouched.
+    inline void flush () const {
+      for (const auto &t: _transport) {
+        std::visit ([] (const auto &t) {
+          if constexpr (requires { t.flush(); })
+            t.flush();
+        }, t);
+      }
+    }
+
     /// @brief Sets the severity threshold for the logger.
     ///
     /// Logging messages which are less severe than the specified level will be ignored.
     ///
+    /// The level may be changed while other threads are logging (e.g. by a ConfigWatcher).
+    ///
     /// @param s The new severity level threshold.
     /// @return The previous severity level threshold.
-    inline Severity setLevel (Severity s) noexcept { return std::exchange (_severity, s); }
+    inline Severity setLevel (Severity s) noexcept { return _severity.exchange (s, std::memory_order_relaxed); }
 
     /// @brief Gets the current severity level threshold of the logger.
     /// @return The current severity level threshold.
-    inline Severity getLevel () const noexcept { return _severity; }
+    inline Severity getLevel () const noexcept { return _severity.load (std::memory_order_relaxed); }
 
     /// @brief Checks if the logger is enabled for the specified severity level.
     /// @param s The severity level to check.
     /// @return `true` if the logger is enabled for the specified level, otherwise `false`.
-    inline bool isEnabled (Severity s) const noexcept { return _severity <= s; }
+    inline bool isEnabled (Severity s) const noexcept { return getLevel() <= s; }
+
+    /// @brief Sets the fraction of the messages of a severity level which are output.
+    ///
+    /// Each log call the logger is enabled for is kept with probability @p rate, drawn from a
+    /// fast per-thread generator, and the kept messages carry a `sample_rate` field with the
+    /// rate. A sampled-out call returns before formatting the message. The rate may be changed
+    /// while other threads are logging.
+    ///
+    /// @param s The severity level. Severity::kNone is never sampled and is ignored.
+    /// @param rate The fraction of the messages which are kept, from 0 to 1 (no sampling, the
+    /// default).
+    inline void setSampleRate (Severity s, double rate) noexcept {
+      const auto index { static_cast<std::size_t> (s) };
+      if (index >= _sampling.size())
+        return;
+
+      const auto threshold { !(rate < 1.0) ? kKeepAll : (rate > 0.0 ? static_cast<std::uint64_t> (rate * 0x1p64) : 0) };
+      _sampling[index].store (threshold, std::memory_order_relaxed);
+    }
+
+    /// @brief Gets the fraction of the messages of a severity level which are output.
+    /// @param s The severity level.
+    /// @return The sample rate, 1 if the messages are not sampled.
+    inline double getSampleRate (Severity s) const noexcept {
+      const auto threshold { sampling (s) };
+      return threshold == kKeepAll ? 1.0 : static_cast<double> (threshold) * 0x1p-64;
+    }
 
     /// @brief Converts a Severity enum value to its corresponding string representation.
     /// @param s The severity level to convert.
     /// @return The string representation of the severity level.
     static inline constexpr const char * toCString (Severity s) { return kStrLevels[static_cast<int_fast8_t> (s)]; }
 
+    /// Name of the field holding the sample rate of the sampled messages.
+    static constexpr std::string_view kSampleRateField { "sample_rate" };
+
   private:
+    // sampling threshold of the severity levels which are not sampled
+    static constexpr std::uint64_t kKeepAll { ~std::uint64_t { 0 } };
+
+    // Gets the sampling threshold of a severity level; Severity::kNone has no slot.
+    inline std::uint64_t sampling (Severity s) const noexcept {
+      const auto index { static_cast<std::size_t> (s) };
+      return index < _sampling.size() ? _sampling[index].load (std::memory_order_relaxed) : kKeepAll;
+    }
+
+    inline void copySampling (const Logger &other) noexcept {
+      for (std::size_t i = 0; i < _sampling.size(); ++i)
+        _sampling[i].store (other._sampling[i].load (std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    // Passes a log call to every transport, updating the metrics if they are attached.
+    template<typename F, typename S>
+    inline void dispatch (Severity s, F &&deliver, S &&size) const {
+      if (!_metrics) {
+        [[maybe_unused]] std::size_t index { 0 };
+        for (const auto &t: _transport) {
+          CXXLOG_PROBE2 (dispatch_start, index, static_cast<int> (s));
+          std::visit (deliver, t);
+          CXXLOG_PROBE2 (dispatch_end, index++, static_cast<int> (s));
+        }
+        return;
+      }
+
+      auto &counters { _metrics->_state->local() };
+      if (const auto level { static_cast<std::size_t> (s) }; level < counters.messages.size())
+        Metrics::add (counters.messages[level], 1); // Severity::kNone has no slot
+
+      std::size_t index { 0 };
+      auto start { std::chrono::steady_clock::now() };
+      for (const auto &t: _transport) {
+        CXXLOG_PROBE2 (dispatch_start, index, static_cast<int> (s));
+        std::visit (deliver, t);
+        const auto end { std::chrono::steady_clock::now() };
+        CXXLOG_PROBE2 (dispatch_end, index, static_cast<int> (s));
+
+        if (index < Metrics::kMaxTransports) {
+          Metrics::add (counters.calls[index], 1);
+          Metrics::add (counters.bytes[index], std::visit (size, t));
+          Metrics::time (counters, index, static_cast<std::uint64_t> (std::chrono::duration_cast<std::chrono::nanoseconds> (end - start).count()));
+        }
+
+        start = end;
+        ++index;
+      }
+    }
+
     mutable std::list<std::variant<Ts...>> _transport {};
-    Severity _severity;
+    mutable std::optional<Metrics> _metrics {};
+    std::atomic<Severity> _severity;
+    std::array<std::atomic<std::uint64_t>, 6> _sampling { kKeepAll, kKeepAll, kKeepAll, kKeepAll, kKeepAll, kKeepAll };
 
     static constexpr std::array<const char *, 6> kStrLevels { "V", "D", "I", "W", "E", "F" };
 };
@@ -0,0 +1,176 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_MODULES_H__
+#define __CXX_LOGGER_MODULES_H__
+
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <concepts>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog {
+
+/// @concept ModuleId
+///
+/// @brief A concept that represents the enumerations identifying the modules of a ModuleLogger.
+///
+/// @tparam M The type to be checked for ModuleId concept compliance.
+///
+/// @requirements
+/// - M is an enumeration whose enumerators are 0, 1, 2... followed by `kCount`, the number of
+///   modules.
+template<typename M>
+concept ModuleId = std::is_enum_v<M> && requires { { M::kCount } -> std::convertible_to<M>; } &&
+  static_cast<std::size_t> (M::kCount) > 0;
+
+/// @class ModuleLogger
+/// @brief A logger with a severity level threshold per module, which can be changed at runtime.
+///
+/// The modules are the enumerators of an enumeration, so their identifiers are assigned at
+/// compile time. The levels are kept in a flat table of atomics indexed by module, aligned to a
+/// cache line, so checking whether a call is enabled is a single indexed relaxed load and
+/// setLevel() can be called from any thread at any time without locks:
+///
+/// @code
+///   enum class Module { kNet, kDb, kCount };
+///
+///   const cxxlog::ModuleLogger<Module, OutputStream> logger { Severity::kWarn };
+///   logger.transport (OutputStream { std::cout });
+///   logger.setLevel (Module::kNet, Severity::kDebug);
+///
+///   logger.debug (Module::kNet, "connected to {}", host); // output
+///   logger.debug (Module::kDb, "query {}", sql);         // not output
+/// @endcode
+///
+/// Copies of a ModuleLogger share the same transports and levels.
+///
+/// @tparam M The ModuleId enumeration.
+/// @tparam Ts Variadic template parameters representing the Loggable transport classes.
+template<ModuleId M, Loggable... Ts>
+class ModuleLogger {
+  public:
+    /// Number of modules.
+    static constexpr std::size_t kModules { static_cast<std::size_t> (M::kCount) };
+
+    /// @brief Constructor for the ModuleLogger class.
+    /// @param severity The initial severity level threshold of every module.
+    ModuleLogger (Severity severity = Severity::kInfo): _state { std::make_shared<State> (severity) } {
+      // empty
+    }
+
+    /// @brief Add a new transport (see Logger::transport).
+    /// @tparam T The type of the transport class.
+    /// @param t An instance of the transport class to be added.
+    template<Loggable T>
+    void transport (T &&t) const {
+      _state->logger.transport (std::forward<T> (t));
+    }
+
+    /// @brief Sets the severity level threshold of a module.
+    /// @param m The module.
+    /// @param s The new severity level threshold.
+    /// @return The previous severity level threshold of the module.
+    Severity setLevel (M m, Severity s) const noexcept {
+      return level (m).exchange (s, std::memory_order_relaxed);
+    }
+
+    /// @brief Sets the severity level threshold of every module.
+    /// @param s The new severity level threshold.
+    void setLevel (Severity s) const noexcept {
+      for (auto &level: _state->levels)
+        level.store (s, std::memory_order_relaxed);
+    }
+
+    /// @brief Gets the severity level threshold of a module.
+    /// @param m The module.
+    /// @return The severity level threshold.
+    Severity getLevel (M m) const noexcept { return level (m).load (std::memory_order_relaxed); }
+
+    /// @brief Checks if a module is enabled for the specified severity level.
+    /// @param m The module.
+    /// @param s The severity level to check.
+    /// @return `true` if the module is enabled for the specified level, otherwise `false`.
+    bool isEnabled (M m, Severity s) const noexcept { return getLevel (m) <= s; }
+
+    /// @brief Logs a message of a module if the module is enabled for its severity level (see
+    /// Logger::log).
+    /// @param m The module.
+    /// @param s The severity level of the message.
+    /// @param fmt The format string for the log message.
+    /// @param args The arguments to be inserted into the format string, then the fields.
+    template<typename... Args>
+    void log (M m, Severity s, detail::FormatString<Args...> fmt, Args && ... args) const {
+      _state->logger.logIf (isEnabled (m, s), s, fmt, std::forward<Args>(args)...);
+    }
+
+    /// @brief Logs a verbose-level message of a module.
+    template<typename... Args>
+    void verbose (M m, detail::FormatString<Args...> fmt, Args && ... args) const {
+      log (m, Severity::kVerbose, fmt, std::forward<Args>(args)...);
+    }
+
+    /// @brief Logs a debug-level message of a module.
+    template<typename... Args>
+    void debug (M m, detail::FormatString<Args...> fmt, Args && ... args) const {
+      log (m, Severity::kDebug, fmt, std::forward<Args>(args)...);
+    }
+
+    /// @brief Logs an info-level message of a module.
+    template<typename... Args>
+    void info (M m, detail::FormatString<Args...> fmt, Args && ... args) const {
+      log (m, Severity::kInfo, fmt, std::forward<Args>(args)...);
+    }
+
+    /// @brief Logs a warning-level message of a module.
+    template<typename... Args>
+    void warn (M m, detail::FormatString<Args...> fmt, Args && ... args) const {
+      log (m, Severity::kWarn, fmt, std::forward<Args>(args)...);
+    }
+
+    /// @brief Logs an error-level message of a module.
+    template<typename... Args>
+    void error (M m, detail::FormatString<Args...> fmt, Args && ... args) const {
+      log (m, Severity::kError, fmt, std::forward<Args>(args)...);
+    }
+
+    /// @brief Logs a fatal-level message of a module.
+    template<typename... Args>
+    void fatal (M m, detail::FormatString<Args...> fmt, Args && ... args) const {
+      log (m, Severity::kFatal, fmt, std::forward<Args>(args)...);
+    }
+
+    /// @brief Flushes the transports (see Logger::flush).
+    void flush () const { _state->logger.flush(); }
+
+  private:
+    std::atomic<Severity> & level (M m) const noexcept { return _state->levels[static_cast<std::size_t> (m)]; }
+
+    struct State {
+      explicit State (Severity severity):
+        logger { Severity::kVerbose }
+      {
+        for (auto &level: levels)
+          level.store (severity, std::memory_order_relaxed);
+      }
+
+      // read on every call, written rarely: kept apart from the logger state
+      alignas (64) std::array<std::atomic<Severity>, kModules> levels {};
+
+      alignas (64) Logger<Ts...> logger;
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+}
+
+#endif
@@ -0,0 +1,56 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_PROBES_H__
+#define __CXX_LOGGER_PROBES_H__
+
+/// @file probes.h
+/// @brief Optional USDT (user statically-defined tracing) probes on the logging path.
+///
+/// When the library is built with `CXXLOG_ENABLE_USDT` defined (the `CXXLOG_ENABLE_USDT` CMake
+/// option), the following probes of the `cxxlog` provider are compiled in with the systemtap
+/// `<sys/sdt.h>` macros. Each probe is a single `nop` instruction until a tracer such as
+/// `bpftrace` or `perf` attaches to it:
+///
+/// | Probe            | Arguments                          | Fired by                                 |
+/// |------------------|------------------------------------|------------------------------------------|
+/// | `enabled`        | severity, 1 if enabled else 0      | every Logger::log call                   |
+/// | `format_start`   | severity                           | Logger::log, before formatting           |
+/// | `format_end`     | severity, message size             | Logger::log, after formatting            |
+/// | `dispatch_start` | transport index, severity          | Logger::log, before each transport call  |
+/// | `dispatch_end`   | transport index, severity          | Logger::log, after each transport call   |
+/// | `async_enqueue`  | queue depth                        | Async, once a message is queued          |
+/// | `async_drop`     | backpressure policy                | Async, when a message is discarded       |
+/// | `async_dequeue`  | severity                           | Async worker, before delivering          |
+/// | `file_append`    | line size                          | AsyncFile, once a line is copied         |
+/// | `file_submit`    | buffer size                        | AsyncFile worker, when writing a buffer  |
+///
+/// For example, the time spent formatting messages:
+///
+/// @code
+///   bpftrace -e 'usdt:./app:cxxlog:format_start { @s[tid] = nsecs; }
+///                usdt:./app:cxxlog:format_end /@s[tid]/ { @ns = hist(nsecs - @s[tid]); delete(@s[tid]); }'
+/// @endcode
+///
+/// Without `CXXLOG_ENABLE_USDT` the probe macros expand to nothing and their arguments are not
+/// evaluated.
+
+/// @cond Doxygen_Suppress
+#ifdef CXXLOG_ENABLE_USDT
+  #if __has_include(<sys/sdt.h>)
+    #include <sys/sdt.h>
+  #else
+    #error "cxxlog: CXXLOG_ENABLE_USDT requires <sys/sdt.h> (systemtap-sdt-dev or systemtap-sdt-devel)"
+  #endif
+
+  #define CXXLOG_PROBE1(name, a) DTRACE_PROBE1 (cxxlog, name, a)
+  #define CXXLOG_PROBE2(name, a, b) DTRACE_PROBE2 (cxxlog, name, a, b)
+#else
+  #define CXXLOG_PROBE1(name, a) ((void) 0)
+  #define CXXLOG_PROBE2(name, a, b) ((void) 0)
+#endif
+/// @endcond
+
+#endif
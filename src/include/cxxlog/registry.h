@@ -0,0 +1,250 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_REGISTRY_H__
+#define __CXX_LOGGER_REGISTRY_H__
+
+#include <atomic>
+#include <cinttypes>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog {
+
+/// @class Registry
+/// @brief A set of named loggers sharing the same transports, each with its own level.
+///
+/// Logger names are hierarchical, with dot-separated components (e.g. "net.http.client"). A
+/// named logger without a level of its own inherits the level of its closest ancestor which has
+/// one, up to the root logger (the empty name), so a whole subsystem can be turned up or down at
+/// once:
+///
+/// @code
+///   const cxxlog::Registry<OutputStream> registry { Severity::kWarn };
+///   registry.transport (OutputStream { std::cout });
+///   registry.setLevel ("net", Severity::kDebug);
+///
+///   static const auto log { registry.get ("net.http.client") };
+///   log.debug ("connected to {}", host); // output: "net" is at debug level
+/// @endcode
+///
+/// Names are interned: get() looks the name up in a hash table, and the Handle it returns
+/// points to the named logger directly. The handle keeps the effective level of the logger,
+/// which setLevel() updates for the whole subtree, so checking whether a call through a handle
+/// is enabled is a single relaxed atomic load, like Logger::isEnabled(). Handles are meant to be
+/// obtained once (e.g. in a static variable) and then reused.
+///
+/// Copies of a Registry, and the handles obtained from it, share the same loggers.
+///
+/// @tparam Ts Variadic template parameters representing the Loggable transport classes.
+template<Loggable... Ts>
+class Registry {
+  private:
+    struct Node;
+    struct State;
+
+  public:
+    /// @class Handle
+    /// @brief A cached reference to a named logger of a Registry.
+    class Handle {
+      public:
+        /// @brief Gets the name of the logger.
+        /// @return The dot-separated name.
+        std::string_view name () const noexcept { return _node->name; }
+
+        /// @brief Gets the effective level of the logger: its own, or the one it inherits.
+        /// @return The severity level threshold.
+        Severity getLevel () const noexcept { return _node->level.load (std::memory_order_relaxed); }
+
+        /// @brief Checks if the logger is enabled for the specified severity level.
+        /// @param s The severity level to check.
+        /// @return `true` if the logger is enabled for the specified level, otherwise `false`.
+        bool isEnabled (Severity s) const noexcept { return getLevel() <= s; }
+
+        /// @brief Logs a message if the logger is enabled for its severity level (see Logger::log).
+        /// @param s The severity level of the message.
+        /// @param fmt The format string for the log message.
+        /// @param args The arguments to be inserted into the format string, then the fields.
+        template<typename... Args>
+        void log (Severity s, detail::FormatString<Args...> fmt, Args && ... args) const {
+          _state->logger.logIf (isEnabled (s), s, fmt, std::forward<Args>(args)...);
+        }
+
+        /// @brief Logs a verbose-level message.
+        template<typename... Args>
+        void verbose (detail::FormatString<Args...> fmt, Args && ... args) const {
+          log (Severity::kVerbose, fmt, std::forward<Args>(args)...);
+        }
+
+        /// @brief Logs a debug-level message.
+        template<typename... Args>
+        void debug (detail::FormatString<Args...> fmt, Args && ... args) const {
+          log (Severity::kDebug, fmt, std::forward<Args>(args)...);
+        }
+
+        /// @brief Logs an info-level message.
+        template<typename... Args>
+        void info (detail::FormatString<Args...> fmt, Args && ... args) const {
+          log (Severity::kInfo, fmt, std::forward<Args>(args)...);
+        }
+
+        /// @brief Logs a warning-level message.
+        template<typename... Args>
+        void warn (detail::FormatString<Args...> fmt, Args && ... args) const {
+          log (Severity::kWarn, fmt, std::forward<Args>(args)...);
+        }
+
+        /// @brief Logs an error-level message.
+        template<typename... Args>
+        void error (detail::FormatString<Args...> fmt, Args && ... args) const {
+          log (Severity::kError, fmt, std::forward<Args>(args)...);
+        }
+
+        /// @brief Logs a fatal-level message.
+        template<typename... Args>
+        void fatal (detail::FormatString<Args...> fmt, Args && ... args) const {
+          log (Severity::kFatal, fmt, std::forward<Args>(args)...);
+        }
+
+      private:
+        friend class Registry;
+
+        Handle (std::shared_ptr<State> state, const Node *node) noexcept:
+          _state { std::move (state) },
+          _node { node }
+        {
+          // empty
+        }
+
+        std::shared_ptr<State> _state;
+        const Node *_node;
+    };
+
+    /// @brief Constructor for the Registry class.
+    /// @param root The level of the root logger, inherited by the loggers without their own.
+    Registry (Severity root = Severity::kInfo): _state { std::make_shared<State> (root) } {
+      // empty
+    }
+
+    /// @brief Add a new transport, shared by all the named loggers (see Logger::transport).
+    /// @tparam T The type of the transport class.
+    /// @param t An instance of the transport class to be added.
+    template<Loggable T>
+    void transport (T &&t) const {
+      _state->logger.transport (std::forward<T> (t));
+    }
+
+    /// @brief Gets a named logger, creating it (and its ancestors) if needed.
+    /// @param name The dot-separated name; the empty name is the root logger.
+    /// @return A handle to the logger.
+    Handle get (std::string_view name) const {
+      const std::lock_guard lock { _state->mutex };
+      return { _state, _state->find (name) };
+    }
+
+    /// @brief Sets the level of a named logger and of its descendants without their own level.
+    /// @param name The dot-separated name.
+    /// @param s The new severity level threshold.
+    void setLevel (std::string_view name, Severity s) const {
+      const std::lock_guard lock { _state->mutex };
+
+      auto *node { _state->find (name) };
+      node->own = s;
+      State::propagate (*node, s);
+    }
+
+    /// @brief Removes the level of a named logger, which inherits the level of its parent again.
+    /// The root logger keeps its level.
+    /// @param name The dot-separated name.
+    void resetLevel (std::string_view name) const {
+      const std::lock_guard lock { _state->mutex };
+
+      auto *node { _state->find (name) };
+      if (!node->parent)
+        return;
+
+      node->own.reset();
+      State::propagate (*node, node->parent->level.load (std::memory_order_relaxed));
+    }
+
+    /// @brief Gets the effective level of a named logger.
+    /// @param name The dot-separated name.
+    /// @return The severity level threshold.
+    Severity getLevel (std::string_view name) const { return get (name).getLevel(); }
+
+    /// @brief Flushes the transports (see Logger::flush).
+    void flush () const { _state->logger.flush(); }
+
+  private:
+    struct Node {
+      std::string name;
+      Node *parent;
+      std::vector<Node *> children {};
+      std::optional<Severity> own {};
+      std::atomic<Severity> level;
+    };
+
+    struct NameHash {
+      using is_transparent = void;
+
+      std::size_t operator() (std::string_view s) const noexcept { return std::hash<std::string_view> {} (s); }
+    };
+
+    struct State {
+      explicit State (Severity root):
+        logger { Severity::kVerbose }
+      {
+        auto node { std::make_unique<Node> (std::string {}, nullptr) };
+        node->own = root;
+        node->level.store (root, std::memory_order_relaxed);
+        nodes.emplace (std::string {}, std::move (node));
+      }
+
+      // Called with the mutex held.
+      Node * find (std::string_view name) {
+        if (const auto it { nodes.find (name) }; it != nodes.end())
+          return it->second.get();
+
+        const auto dot { name.rfind ('.') };
+        auto *parent { find (dot == std::string_view::npos ? std::string_view {} : name.substr (0, dot)) };
+
+        auto node { std::make_unique<Node> (std::string { name }, parent) };
+        node->level.store (parent->level.load (std::memory_order_relaxed), std::memory_order_relaxed);
+        parent->children.push_back (node.get());
+
+        return nodes.emplace (std::string { name }, std::move (node)).first->second.get();
+      }
+
+      // Sets the effective level of a node and of the descendants which inherit it.
+      static void propagate (Node &node, Severity s) {
+        node.level.store (s, std::memory_order_relaxed);
+        for (auto *child: node.children) {
+          if (!child->own)
+            propagate (*child, s);
+        }
+      }
+
+      Logger<Ts...> logger;
+
+      std::mutex mutex {};
+      std::unordered_map<std::string, std::unique_ptr<Node>, NameHash, std::equal_to<>> nodes {};
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+}
+
+#endif
@@ -0,0 +1,147 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_THROTTLE_H__
+#define __CXX_LOGGER_THROTTLE_H__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog {
+
+/// @class EveryN
+/// @brief Lets through one call out of every N: the 1st, the N+1th, the 2N+1th...
+///
+/// The state of a throttle is a single lock-free counter; it is meant to be a static variable
+/// of a call site (see CXXLOG_LOG_EVERY_N).
+class EveryN {
+  public:
+    /// @brief Constructor for the EveryN class.
+    /// @param n The period; 0 is taken as 1.
+    constexpr explicit EveryN (std::uint64_t n) noexcept: _n { std::max<std::uint64_t> (n, 1) } {
+      // empty
+    }
+
+    /// @brief Counts a call.
+    /// @return `true` if the call is let through.
+    bool allow () noexcept { return _count.fetch_add (1, std::memory_order_relaxed) % _n == 0; }
+
+  private:
+    const std::uint64_t _n;
+    std::atomic<std::uint64_t> _count { 0 };
+};
+
+/// @class Once
+/// @brief Lets through the first call only.
+class Once {
+  public:
+    constexpr Once () noexcept = default;
+
+    /// @brief Counts a call.
+    /// @return `true` for the first call.
+    bool allow () noexcept {
+      return !_done.load (std::memory_order_relaxed) && !_done.exchange (true, std::memory_order_relaxed);
+    }
+
+  private:
+    std::atomic<bool> _done { false };
+};
+
+/// @class RateLimit
+/// @brief Lets through at most K calls per second.
+///
+/// The limit applies to fixed one-second windows of the steady clock. The window and the number
+/// of calls in it are packed in one atomic word, so counting a call is a single fetch-add except
+/// for the first call of each window, which resets the count.
+class RateLimit {
+  public:
+    /// @brief Constructor for the RateLimit class.
+    /// @param perSecond The maximum number of calls let through per second.
+    constexpr explicit RateLimit (std::uint32_t perSecond) noexcept: _limit { perSecond } {
+      // empty
+    }
+
+    /// @brief Counts a call.
+    /// @return `true` if the call is let through.
+    bool allow () noexcept {
+      return allow (static_cast<std::uint64_t> (std::chrono::duration_cast<std::chrono::seconds> (std::chrono::steady_clock::now().time_since_epoch()).count()));
+    }
+
+    /// @brief Counts a call made during a given second.
+    /// @param second The index of the current one-second window.
+    /// @return `true` if the call is let through.
+    bool allow (std::uint64_t second) noexcept {
+      const auto window { (second + 1) & kWindowMask }; // 0 is the initial state
+      auto old { _state.fetch_add (1, std::memory_order_relaxed) };
+
+      if ((old >> kCountBits) == window)
+        return (old & kCountMask) < _limit;
+
+      // first call of a new window: reset it, unless another thread did
+      auto seen { old + 1 };
+      while ((seen >> kCountBits) < window) {
+        if (_state.compare_exchange_weak (seen, (window << kCountBits) | 1, std::memory_order_relaxed))
+          return _limit > 0;
+      }
+
+      // a thread which read the clock later moved to a newer window
+      if ((seen >> kCountBits) > window)
+        return false;
+
+      return (_state.fetch_add (1, std::memory_order_relaxed) & kCountMask) < _limit;
+    }
+
+  private:
+    static constexpr unsigned kCountBits { 32 };
+    static constexpr std::uint64_t kCountMask { (std::uint64_t { 1 } << kCountBits) - 1 };
+    static constexpr std::uint64_t kWindowMask { (std::uint64_t { 1 } << (64 - kCountBits)) - 1 };
+
+    const std::uint32_t _limit;
+    std::atomic<std::uint64_t> _state { 0 };
+};
+
+}
+
+/// @cond Doxygen_Suppress
+// the calls which aren't output still reach the Capturing transports, as with Logger::log
+#define CXXLOG_THROTTLED_(logger, severity, throttle, fmt, ...)                                   \
+  do {                                                                                             \
+    static throttle;                                                                               \
+    (logger).logIf ((logger).isEnabled (severity) && cxxlog_throttle_.allow(), severity, fmt       \
+      __VA_OPT__(,) __VA_ARGS__);                                                                  \
+  } while (false)
+/// @endcond
+
+/// @brief Logs a message through a Logger on the 1st, N+1th, 2N+1th... enabled call of the
+/// statement. The other calls cost one atomic increment and are not formatted.
+/// @param logger The Logger.
+/// @param severity The severity level of the message.
+/// @param n The period.
+/// @param fmt The format string, followed by the arguments and the fields.
+#define CXXLOG_LOG_EVERY_N(logger, severity, n, fmt, ...) \
+  CXXLOG_THROTTLED_ (logger, severity, ::cxxlog::EveryN cxxlog_throttle_ { n }, fmt __VA_OPT__(,) __VA_ARGS__)
+
+/// @brief Logs a message through a Logger on the first enabled call of the statement only.
+/// @param logger The Logger.
+/// @param severity The severity level of the message.
+/// @param fmt The format string, followed by the arguments and the fields.
+#define CXXLOG_LOG_ONCE(logger, severity, fmt, ...) \
+  CXXLOG_THROTTLED_ (logger, severity, ::cxxlog::Once cxxlog_throttle_ {}, fmt __VA_OPT__(,) __VA_ARGS__)
+
+/// @brief Logs a message through a Logger at most K times per second from the statement. The
+/// other calls cost one atomic increment and are not formatted.
+/// @param logger The Logger.
+/// @param severity The severity level of the message.
+/// @param perSecond The maximum number of messages per second.
+/// @param fmt The format string, followed by the arguments and the fields.
+#define CXXLOG_LOG_RATE(logger, severity, perSecond, fmt, ...) \
+  CXXLOG_THROTTLED_ (logger, severity, ::cxxlog::RateLimit cxxlog_throttle_ { perSecond }, fmt __VA_OPT__(,) __VA_ARGS__)
+
+#endif
@@ -8,27 +8,32 @@
 
 #include <cinttypes>
 #include <chrono>
-#include <ctime>
-#include <iomanip>
 #include <ostream>
 #include <string>
 
+#include <cxxlog/layout.h>
 #include <cxxlog/logger.h>
 
 
 namespace cxxlog::transport {
 
-/// @class OutputStream
+/// @class BasicOutputStream
 /// @brief A class for logging messages to an output stream with timestamp and severity level.
 ///
 /// This class provides a way to log messages to an output stream with a timestamp and a specified
-/// severity level. The log messages are formatted in the following way:
+/// severity level. With the default layout, the log messages are formatted in the following way:
 /// "<timestamp> <severity>: <message>\n"
-class OutputStream {
+///
+/// @tparam L The layout of the log lines (e.g. a PatternLayout).
+template<Layout L = DefaultLayout>
+class BasicOutputStream {
   public:
+    /// The layout of the log lines, rendered once per record by the Logger.
+    using layout_type = L;
+
     /// @brief Constructor for the OutputStream class.
     /// @param out The output stream to which log messages will be written.
-    OutputStream (std::ostream &out): _out { out } {
+    BasicOutputStream (std::ostream &out): _out { out } {
       // empty
     }
 
@@ -41,22 +46,30 @@ class OutputStream {
     /// indicating when the message was logged. The message is written to the output stream
     /// provided in the constructor.
     ///
-    /// @note The timestamp is UTC in the format "YYYY-MM-DDTHH:MM:SS".
+    /// @note With the default layout, the timestamp is UTC in the format "YYYY-MM-DDTHH:MM:SS".
     void log (const std::string &msg, Severity s, std::chrono::milliseconds ts) const {
-      auto epochSecs { std::chrono::system_clock::to_time_t (std::chrono::time_point<std::chrono::system_clock> (ts)) };
-
-      // format epochSecs as a date time to seconds resolution (e.g. 2016-08-30T08:18:51)
-      struct tm buf {};
-      _out.get()
-        << std::put_time (gmtime_r (&epochSecs, &buf), "%FT%T")
-        << " " << Logger<>::toCString (s)
-        << ": " << msg << "\n";
+      log (Record::View { msg, s, ts });
+    }
+
+    /// @brief Log a record.
+    /// @param record The log record.
+    ///
+    /// Writes the record message surrounded by the text of the layout, using the text
+    /// rendered once by the Logger when available.
+    void log (const Record &record) const {
+      thread_local std::string scratch {};
+      const auto parts { record.parts<layout_type> (scratch) };
+
+      _out.get() << parts.prefix << record.message() << parts.suffix;
     }
 
   private:
     std::reference_wrapper<std::ostream> _out;
 };
 
+/// A BasicOutputStream writing lines with the default layout.
+using OutputStream = BasicOutputStream<>;
+
 }
 
 #endif
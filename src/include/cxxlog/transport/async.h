@@ -0,0 +1,318 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_TRANSPORT_ASYNC_H__
+#define __CXX_LOGGER_TRANSPORT_ASYNC_H__
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cinttypes>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <cxxlog/crash.h>
+#include <cxxlog/logger.h>
+#include <cxxlog/probes.h>
+
+
+namespace cxxlog::transport {
+
+/// @enum Backpressure
+/// @brief What an Async transport does with a log message when its queue is full.
+enum class Backpressure: std::int_fast8_t {
+  kBlock = 0x00,      ///< Wait until the queue has room for the message.
+  kDropNewest = 0x01, ///< Discard the message being logged.
+  kDropOldest = 0x02  ///< Discard the oldest queued message to make room for the new one.
+};
+
+/// @class Async
+/// @brief A wrapper which moves the calls to a transport to its own background thread.
+///
+/// Log messages are pushed into a bounded lock-free queue and a dedicated thread passes them to
+/// the wrapped transport, so a slow transport (e.g. a network one) doesn't delay the other
+/// transports of the same Logger. Each wrapper has its own queue, thread and backpressure policy:
+///
+/// @code
+///   const cxxlog::Logger<OutputStream, Async<Network>> logger {};
+///   logger.transport (OutputStream { std::cout });
+///   logger.transport (Async<Network> { Network { host }, 4096, Backpressure::kDropOldest });
+/// @endcode
+///
+/// The queue holds the shared Record of each log call, so the message is not copied and the
+/// layout text rendered by the Logger is still available to the wrapped transport, whose
+/// `layout_type` (if any) the wrapper exposes. Messages are delivered in the order they were queued. Exceptions thrown by the wrapped
+/// transport are discarded. Pending messages are delivered before the last copy of the wrapper is
+/// destroyed.
+///
+/// A CrashHandler watching the wrapper writes the queued messages if the process crashes.
+///
+/// Copies of an Async wrapper share the same queue and background thread.
+///
+/// @tparam T The Loggable transport type to wrap.
+template<Loggable T>
+class Async: public detail::LayoutTraits<T> {
+  public:
+    /// Default queue capacity.
+    static constexpr std::size_t kDefaultCapacity { 8192 };
+
+    /// @brief Constructor for the Async class.
+    /// @param transport The transport to which log messages are passed by the background thread.
+    /// @param capacity Maximum number of queued messages. It is rounded up to a power of two.
+    /// @param policy What to do with log messages when the queue is full.
+    Async (T transport, std::size_t capacity = kDefaultCapacity, Backpressure policy = Backpressure::kBlock):
+      _state { std::make_shared<State> (std::move (transport), capacity, policy) }
+    {
+      // empty
+    }
+
+    /// @brief Queues a message with a specified severity level and timestamp.
+    /// @param msg The message to be logged.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    void log (const std::string &msg, Severity s, std::chrono::milliseconds ts) const {
+      _state->push (Record { msg, s, ts });
+    }
+
+    /// @brief Queues a record.
+    /// @param record The log record.
+    void log (const Record &record) const {
+      _state->push (Record { record });
+    }
+
+    /// @brief Blocks until every queued message has been passed to the wrapped transport, then
+    /// flushes the wrapped transport if it provides a `flush()` method.
+    void flush () const { _state->flush(); }
+
+    /// @brief Writes the queued messages to a file descriptor, using only async-signal-safe
+    /// operations (see CrashHandler). The messages held by the wrapped transport, if it is
+    /// CrashDumpable, are written first.
+    /// @param out The writer of the file descriptor.
+    void crashDump (cxxlog::detail::RawWriter &out) const noexcept { _state->crashDump (out); }
+
+    /// @brief Gets the number of messages discarded because the queue was full.
+    /// @return The number of dropped messages.
+    std::uint64_t dropped () const noexcept { return _state->dropped.load (std::memory_order_relaxed); }
+
+    /// @brief Gets the highest number of messages which were queued at once.
+    /// @return The high-water mark of the queue.
+    std::size_t highWater () const noexcept { return _state->highWater.load (std::memory_order_relaxed); }
+
+    /// @brief Gets the queue capacity.
+    /// @return The maximum number of queued messages.
+    std::size_t capacity () const noexcept { return _state->mask + 1; }
+
+    /// @brief Gets the function which reads the counters of the wrapper for Metrics. It only
+    /// keeps a weak reference to the queue, so the wrapper can still be destroyed.
+    /// @return The function filling the dropped and high-water counters.
+    std::function<void (Metrics::TransportStats &)> probe () const {
+      return [ weak = std::weak_ptr<State> { _state } ] (Metrics::TransportStats &stats) {
+        if (const auto state { weak.lock() }) {
+          stats.dropped = state->dropped.load (std::memory_order_relaxed);
+          stats.highWater = state->highWater.load (std::memory_order_relaxed);
+        }
+      };
+    }
+
+  private:
+    // Bounded MPMC queue (D. Vyukov): each cell carries the sequence number of the position
+    // which may use it next, so producers and consumers only contend on their own counter.
+    struct alignas (64) Cell {
+      std::atomic<std::size_t> sequence { 0 };
+      Record entry {};
+    };
+
+    struct State {
+      State (T &&t, std::size_t capacity, Backpressure p):
+        transport { std::move (t) },
+        policy { p },
+        mask { std::bit_ceil (std::max<std::size_t> (capacity, 2)) - 1 },
+        cells { std::make_unique<Cell[]> (mask + 1) }
+      {
+        for (std::size_t i = 0; i <= mask; ++i)
+          cells[i].sequence.store (i, std::memory_order_relaxed);
+
+        worker = std::thread { [ this ] () { run(); } };
+      }
+
+      ~State () {
+        stop.store (true, std::memory_order_seq_cst);
+        wake();
+        worker.join();
+      }
+
+      void push (Record &&e) {
+        while (!enqueue (e)) {
+          switch (policy) {
+            case Backpressure::kBlock:
+              wake();
+              std::this_thread::yield();
+              break;
+
+            case Backpressure::kDropNewest:
+              CXXLOG_PROBE1 (async_drop, static_cast<int> (policy));
+              dropped.fetch_add (1, std::memory_order_relaxed);
+              return;
+
+            case Backpressure::kDropOldest:
+              if (Record old {}; dequeue (old)) {
+                CXXLOG_PROBE1 (async_drop, static_cast<int> (policy));
+                dropped.fetch_add (1, std::memory_order_relaxed);
+                done.fetch_add (1, std::memory_order_release);
+              }
+              break;
+          }
+        }
+
+        // queue depth for the high-water mark; the relaxed loads may see done ahead of enqueuePos
+        const auto delivered { done.load (std::memory_order_relaxed) };
+        const auto queued { enqueuePos.load (std::memory_order_relaxed) };
+        const auto depth { queued > delivered ? queued - delivered : 0 };
+        auto highest { highWater.load (std::memory_order_relaxed) };
+        while (depth > highest && !highWater.compare_exchange_weak (highest, depth, std::memory_order_relaxed)) {
+          // retry
+        }
+
+        CXXLOG_PROBE1 (async_enqueue, depth);
+
+        // pairs with run(): either the worker sees the new position or we see it sleeping
+        if (sleeping.load (std::memory_order_seq_cst))
+          wake();
+      }
+
+      void flush () {
+        const auto target { enqueuePos.load (std::memory_order_acquire) };
+        while (done.load (std::memory_order_acquire) < target) {
+          wake();
+          std::this_thread::yield();
+        }
+
+        if constexpr (requires { transport.flush(); })
+          transport.flush();
+      }
+
+      void crashDump (cxxlog::detail::RawWriter &out) const noexcept {
+        if constexpr (CrashDumpable<T>)
+          transport.crashDump (out);
+
+        const auto last { enqueuePos.load (std::memory_order_acquire) };
+        for (auto pos = dequeuePos.load (std::memory_order_acquire); pos < last; ++pos) {
+          const auto &cell { cells[pos & mask] };
+          if (cell.sequence.load (std::memory_order_acquire) != pos + 1 || !cell.entry)
+            continue;
+
+          out.line (cell.entry.severity(), cell.entry.timestamp(), cell.entry.message(), cell.entry.fields());
+        }
+      }
+
+      void wake () {
+        if (sleeping.exchange (false, std::memory_order_relaxed))
+          sleeping.notify_one();
+      }
+
+      bool enqueue (Record &e) {
+        auto pos { enqueuePos.load (std::memory_order_relaxed) };
+        for (;;) {
+          auto &cell { cells[pos & mask] };
+          const auto seq { cell.sequence.load (std::memory_order_acquire) };
+          const auto diff { static_cast<std::intptr_t> (seq) - static_cast<std::intptr_t> (pos) };
+
+          if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak (pos, pos + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+              cell.entry = std::move (e);
+              cell.sequence.store (pos + 1, std::memory_order_release);
+              return true;
+            }
+          }
+          else if (diff < 0) {
+            return false;
+          }
+          else {
+            pos = enqueuePos.load (std::memory_order_relaxed);
+          }
+        }
+      }
+
+      bool dequeue (Record &e) {
+        auto pos { dequeuePos.load (std::memory_order_relaxed) };
+        for (;;) {
+          auto &cell { cells[pos & mask] };
+          const auto seq { cell.sequence.load (std::memory_order_acquire) };
+          const auto diff { static_cast<std::intptr_t> (seq) - static_cast<std::intptr_t> (pos + 1) };
+
+          if (diff == 0) {
+            if (dequeuePos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed)) {
+              e = std::move (cell.entry);
+              cell.sequence.store (pos + mask + 1, std::memory_order_release);
+              return true;
+            }
+          }
+          else if (diff < 0) {
+            return false;
+          }
+          else {
+            pos = dequeuePos.load (std::memory_order_relaxed);
+          }
+        }
+      }
+
+      // Background thread.
+      void run () {
+        Record e {};
+        for (;;) {
+          while (dequeue (e)) {
+            CXXLOG_PROBE1 (async_dequeue, static_cast<int> (e.severity()));
+            try {
+              detail::deliver (transport, e);
+            }
+            catch (...) {
+              // a failing transport must not take the thread down
+            }
+            e = {};
+            done.fetch_add (1, std::memory_order_release);
+          }
+
+          if (stop.load (std::memory_order_relaxed)) {
+            if (dequeuePos.load (std::memory_order_acquire) == enqueuePos.load (std::memory_order_acquire))
+              return;
+            continue;
+          }
+
+          sleeping.store (true, std::memory_order_seq_cst);
+          if (dequeuePos.load (std::memory_order_relaxed) != enqueuePos.load (std::memory_order_seq_cst) || stop.load (std::memory_order_seq_cst)) {
+            sleeping.store (false, std::memory_order_relaxed);
+            continue;
+          }
+
+          sleeping.wait (true, std::memory_order_relaxed);
+        }
+      }
+
+      T transport;
+      Backpressure policy;
+      std::size_t mask;
+      std::unique_ptr<Cell[]> cells;
+
+      alignas (64) std::atomic<std::size_t> enqueuePos { 0 };
+      alignas (64) std::atomic<std::size_t> dequeuePos { 0 };
+      alignas (64) std::atomic<std::uint64_t> done { 0 };
+      std::atomic<std::uint64_t> dropped { 0 };
+      std::atomic<std::size_t> highWater { 0 };
+      std::atomic<bool> sleeping { false };
+      std::atomic<bool> stop { false };
+
+      std::thread worker {};
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+}
+
+#endif
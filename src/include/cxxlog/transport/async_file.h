@@ -0,0 +1,579 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_TRANSPORT_ASYNC_FILE_H__
+#define __CXX_LOGGER_TRANSPORT_ASYNC_FILE_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+
+  #define CXXLOG_HAS_IO_URING 1
+#endif
+
+#include <cxxlog/layout.h>
+#include <cxxlog/logger.h>
+#include <cxxlog/probes.h>
+
+
+namespace cxxlog::transport {
+
+/// @cond Doxygen_Suppress
+namespace detail {
+
+#ifdef CXXLOG_HAS_IO_URING
+  /// Minimal io_uring wrapper used by AsyncFile to submit writes and reap their completions.
+  class Uring {
+    public:
+      Uring (unsigned entries, const std::vector<struct iovec> &buffers) {
+        struct io_uring_params params {};
+        _fd = static_cast<int> (::syscall (__NR_io_uring_setup, entries, &params));
+        if (_fd < 0)
+          return;
+
+        _sqSize = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+        _cqSize = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+          _sqSize = _cqSize = std::max (_sqSize, _cqSize);
+
+        _sq = ::mmap (nullptr, _sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+        if (_sq == MAP_FAILED) {
+          _sq = nullptr;
+          close();
+          return;
+        }
+
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+          _cq = _sq;
+        }
+        else {
+          _cq = ::mmap (nullptr, _cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+          if (_cq == MAP_FAILED) {
+            _cq = nullptr;
+            close();
+            return;
+          }
+        }
+
+        _sqesSize = params.sq_entries * sizeof (struct io_uring_sqe);
+        void *sqes { ::mmap (nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES) };
+        if (sqes == MAP_FAILED) {
+          close();
+          return;
+        }
+        _sqes = static_cast<struct io_uring_sqe *> (sqes);
+
+        auto *sq { static_cast<char *> (_sq) };
+        _sqHead = reinterpret_cast<unsigned *> (sq + params.sq_off.head);
+        _sqTail = reinterpret_cast<unsigned *> (sq + params.sq_off.tail);
+        _sqMask = *reinterpret_cast<unsigned *> (sq + params.sq_off.ring_mask);
+        _sqArray = reinterpret_cast<unsigned *> (sq + params.sq_off.array);
+
+        auto *cq { static_cast<char *> (_cq) };
+        _cqHead = reinterpret_cast<unsigned *> (cq + params.cq_off.head);
+        _cqTail = reinterpret_cast<unsigned *> (cq + params.cq_off.tail);
+        _cqMask = *reinterpret_cast<unsigned *> (cq + params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<struct io_uring_cqe *> (cq + params.cq_off.cqes);
+
+        // registered buffers need locked memory; plain writes are used if they can't be pinned
+        _fixed = ::syscall (__NR_io_uring_register, _fd, IORING_REGISTER_BUFFERS, buffers.data(), buffers.size()) == 0;
+      }
+
+      ~Uring () { close(); }
+
+      Uring (const Uring &) = delete;
+      Uring & operator= (const Uring &) = delete;
+
+      bool valid () const noexcept { return _fd >= 0; }
+
+      // Queues a write of buffer `index` and submits it to the kernel.
+      bool write (int fd, unsigned index, const char *data, std::size_t size, std::uint64_t offset) {
+        const unsigned tail { *_sqTail };
+        const unsigned idx { tail & _sqMask };
+
+        auto &sqe { _sqes[idx] };
+        std::memset (&sqe, 0, sizeof (sqe));
+        sqe.opcode = _fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<std::uint64_t> (data);
+        sqe.len = static_cast<std::uint32_t> (size);
+        sqe.off = offset;
+        sqe.buf_index = static_cast<std::uint16_t> (_fixed ? index : 0);
+        sqe.user_data = index;
+
+        _sqArray[idx] = idx;
+        __atomic_store_n (_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        if (enter (1, 0, 0) == 1)
+          return true;
+
+        // the kernel only consumes entries in io_uring_enter: one it took is in flight and
+        // completes as usual, one it left (e.g. -EBUSY) is taken back, so the caller can write
+        // the buffer synchronously without a later enter submitting it again
+        if (__atomic_load_n (_sqHead, __ATOMIC_ACQUIRE) != tail)
+          return true;
+
+        __atomic_store_n (_sqTail, tail, __ATOMIC_RELEASE);
+        return false;
+      }
+
+      // Reaps completions, calling fn (index, result) for each one. Waits for at least one if wait is set.
+      template<typename Fn>
+      void reap (bool wait, Fn &&fn) {
+        if (wait)
+          enter (0, 1, IORING_ENTER_GETEVENTS);
+
+        unsigned head { *_cqHead };
+        const unsigned tail { __atomic_load_n (_cqTail, __ATOMIC_ACQUIRE) };
+        for (; head != tail; ++head) {
+          const auto &cqe { _cqes[head & _cqMask] };
+          fn (static_cast<unsigned> (cqe.user_data), cqe.res);
+        }
+
+        __atomic_store_n (_cqHead, head, __ATOMIC_RELEASE);
+      }
+
+    private:
+      int enter (unsigned submit, unsigned minComplete, unsigned flags) {
+        int r;
+        do {
+          r = static_cast<int> (::syscall (__NR_io_uring_enter, _fd, submit, minComplete, flags, nullptr, 0));
+        } while (r < 0 && errno == EINTR);
+
+        return r;
+      }
+
+      void close () {
+        if (_sqes)
+          ::munmap (_sqes, _sqesSize);
+        if (_cq && _cq != _sq)
+          ::munmap (_cq, _cqSize);
+        if (_sq)
+          ::munmap (_sq, _sqSize);
+        if (_fd >= 0)
+          ::close (_fd);
+
+        _sqes = nullptr;
+        _sq = _cq = nullptr;
+        _fd = -1;
+      }
+
+      int _fd { -1 };
+      bool _fixed { false };
+      void *_sq { nullptr };
+      void *_cq { nullptr };
+      std::size_t _sqSize { 0 };
+      std::size_t _cqSize { 0 };
+      std::size_t _sqesSize { 0 };
+      struct io_uring_sqe *_sqes { nullptr };
+      unsigned *_sqHead { nullptr };
+      unsigned *_sqTail { nullptr };
+      unsigned *_sqArray { nullptr };
+      unsigned _sqMask { 0 };
+      unsigned *_cqHead { nullptr };
+      unsigned *_cqTail { nullptr };
+      struct io_uring_cqe *_cqes { nullptr };
+      unsigned _cqMask { 0 };
+  };
+#endif
+
+}
+/// @endcond
+
+/// @class BasicAsyncFile
+/// @brief A class for logging messages to a file without blocking the logging thread on I/O.
+///
+/// Log lines are copied into a small set of fixed-size buffers. A buffer is handed to a
+/// background thread once it is full or after the flush interval elapses, and the background
+/// thread submits it as a single write through io_uring (using registered buffers when the
+/// kernel allows it) and reaps the completions. On systems without io_uring, or when the kernel
+/// refuses to create a ring, the background thread issues the writes with `pwrite(2)` instead.
+///
+/// The logging thread only reserves space in the current buffer with a compare-and-swap and copies the
+/// line; it never issues a blocking system call. If every buffer is waiting on the disk, it spins
+/// until one is released. Lines longer than a buffer are truncated to the buffer size.
+/// Log lines are written with the layout L, by default the same as OutputStream: "<timestamp> <severity>: <message>\n".
+///
+/// Copies of an AsyncFile share the same underlying file and background thread.
+///
+/// @tparam L The layout of the log lines (e.g. a PatternLayout).
+template<Layout L = DefaultLayout>
+class BasicAsyncFile {
+  public:
+    /// The layout of the log lines, rendered once per record by the Logger.
+    using layout_type = L;
+
+    /// Default size of each buffer (64 KiB).
+    static constexpr std::size_t kDefaultBufferSize { 64u << 10 };
+    /// Default number of buffers.
+    static constexpr std::size_t kDefaultBuffers { 8 };
+    /// Default maximum time a line waits in a partially filled buffer.
+    static constexpr std::chrono::milliseconds kDefaultFlushInterval { 100 };
+
+    /// @brief Constructor for the AsyncFile class.
+    /// @param path File to which log messages will be appended. It is created if it doesn't exist.
+    /// @param bufferSize Size of each buffer.
+    /// @param buffers Number of buffers (at least 2).
+    /// @param flushInterval Maximum time a line waits in a partially filled buffer.
+    /// @throw std::system_error if the file can't be opened.
+    BasicAsyncFile (
+      const std::filesystem::path &path,
+      std::size_t bufferSize = kDefaultBufferSize,
+      std::size_t buffers = kDefaultBuffers,
+      std::chrono::milliseconds flushInterval = kDefaultFlushInterval
+    ):
+      _state { std::make_shared<State> (path, bufferSize, std::max<std::size_t> (buffers, 2), flushInterval) }
+    {
+      // empty
+    }
+
+    /// @brief Log a message with a specified severity level and timestamp.
+    /// @param msg The message to be logged.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    void log (const std::string &msg, Severity s, std::chrono::milliseconds ts) const {
+      log (Record::View { msg, s, ts });
+    }
+
+    /// @brief Log a record.
+    /// @param record The log record.
+    void log (const Record &record) const {
+      thread_local std::string scratch {};
+      _state->append (record.parts<layout_type> (scratch), record.message());
+    }
+
+    /// @brief Blocks until every line logged so far has been written to the file.
+    void flush () const { _state->flush(); }
+
+    /// @brief Checks whether the writes are submitted through io_uring.
+    /// @return `true` if io_uring is used, `false` if the `pwrite(2)` fallback is used.
+    bool usesIoUring () const noexcept { return _state->usesIoUring(); }
+
+  private:
+    struct State {
+      // A reservation word packs the generation the buffer is serving, a sealed flag and the
+      // number of bytes reserved, so a thread holding a stale generation can't reserve space in it.
+      static constexpr unsigned kGenerationShift { 41 };
+      static constexpr std::uint64_t kSealed { std::uint64_t { 1 } << 40 };
+      static constexpr std::uint64_t kOffsetMask { kSealed - 1 };
+
+      static constexpr std::uint64_t word (std::size_t generation, std::uint64_t offset) noexcept {
+        return (static_cast<std::uint64_t> (generation) << kGenerationShift) | offset;
+      }
+
+      static constexpr bool sameGeneration (std::uint64_t w, std::size_t generation) noexcept {
+        return (w >> kGenerationShift) == (word (generation, 0) >> kGenerationShift);
+      }
+
+      enum class Status: int { kFree, kSealed, kInFlight };
+
+      struct Buffer {
+        std::unique_ptr<char[]> data {};
+        std::atomic<std::uint64_t> reserved { 0 };
+        std::atomic<std::uint64_t> committed { 0 };
+        std::atomic<Status> status { Status::kFree };
+        std::size_t generation { 0 };
+        std::size_t size { 0 };
+      };
+
+      State (const std::filesystem::path &path, std::size_t bufferSize, std::size_t buffers, std::chrono::milliseconds interval):
+        capacity { std::min<std::size_t> (bufferSize, kOffsetMask) },
+        flushInterval { interval },
+        slots (buffers)
+      {
+        fd = ::open (path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+          throw std::system_error { errno, std::generic_category(), "cannot open " + path.string() };
+
+        struct stat st {};
+        ::fstat (fd, &st);
+        offset = static_cast<std::uint64_t> (st.st_size);
+
+        std::vector<struct iovec> iov {};
+        for (std::size_t i = 0; i < slots.size(); ++i) {
+          auto &b { slots[i] };
+          b.data = std::make_unique<char[]> (capacity);
+          b.generation = i;
+          b.reserved.store (word (i, 0), std::memory_order_relaxed);
+          iov.push_back ({ b.data.get(), capacity });
+        }
+
+#ifdef CXXLOG_HAS_IO_URING
+        ring = std::make_unique<detail::Uring> (static_cast<unsigned> (slots.size()), iov);
+        if (!ring->valid())
+          ring.reset();
+#endif
+
+        worker = std::thread { [ this ] () { run(); } };
+      }
+
+      ~State () {
+        {
+          std::lock_guard lock { mutex };
+          stop = true;
+        }
+        cv.notify_one();
+        worker.join();
+
+        ::close (fd);
+      }
+
+      bool usesIoUring () const noexcept {
+#ifdef CXXLOG_HAS_IO_URING
+        return ring != nullptr;
+#else
+        return false;
+#endif
+      }
+
+      // Called by the logging threads.
+      void append (const Record::Parts &parts, std::string_view msg) {
+        const auto n { std::min<std::size_t> (parts.prefix.size() + msg.size() + parts.suffix.size(), capacity) };
+
+        for (;;) {
+          const auto c { current.load (std::memory_order_acquire) };
+          auto &b { slots[c % slots.size()] };
+
+          auto w { b.reserved.load (std::memory_order_acquire) };
+          if (!sameGeneration (w, c) || (w & kSealed)) {
+            std::this_thread::yield();
+            continue;
+          }
+
+          const auto off { w & kOffsetMask };
+          if (off + n > capacity) {
+            // the line that doesn't fit seals the buffer; it is retried with the next one
+            if (b.reserved.compare_exchange_weak (w, w | kSealed, std::memory_order_acq_rel))
+              seal (c, off);
+            continue;
+          }
+
+          if (!b.reserved.compare_exchange_weak (w, w + n, std::memory_order_acq_rel))
+            continue;
+
+          // a truncated line keeps its suffix (the line feed of the default layout)
+          auto *p { b.data.get() + off };
+          const auto suffix { std::min (parts.suffix.size(), n) };
+          const auto prefix { std::min (parts.prefix.size(), n - suffix) };
+          std::memcpy (p, parts.prefix.data(), prefix);
+          std::memcpy (p + prefix, msg.data(), n - suffix - prefix);
+          std::memcpy (p + n - suffix, parts.suffix.data(), suffix);
+
+          b.committed.fetch_add (n, std::memory_order_release);
+          CXXLOG_PROBE1 (file_append, n);
+          return;
+        }
+      }
+
+      // Hands the buffer of generation c, holding size bytes, to the background thread and makes the
+      // next buffer current.
+      void seal (std::size_t c, std::uint64_t size) {
+        auto &b { slots[c % slots.size()] };
+        b.size = static_cast<std::size_t> (size);
+        b.status.store (Status::kSealed, std::memory_order_release);
+
+        // the worker checks the status under the mutex before it waits, so the wakeup isn't lost
+        auto &next { slots[(c + 1) % slots.size()] };
+        {
+          std::unique_lock lock { mutex };
+          cv.notify_one();
+          freedCv.wait (lock, [ &next ] () { return next.status.load (std::memory_order_acquire) == Status::kFree; });
+        }
+
+        current.store (c + 1, std::memory_order_release);
+      }
+
+      void flush () {
+        std::unique_lock lock { mutex };
+        const auto ticket { ++flushRequested };
+        cv.notify_one();
+        flushedCv.wait (lock, [ this, ticket ] () { return flushed >= ticket || stop; });
+      }
+
+      // Background thread.
+      void run () {
+        std::size_t next { 0 };  // generation of the next buffer to submit
+        std::size_t inFlight { 0 };
+
+        for (;;) {
+          // submit every sealed buffer in order
+          for (;;) {
+            auto &b { slots[next % slots.size()] };
+            if (b.status.load (std::memory_order_acquire) != Status::kSealed)
+              break;
+
+            while (b.committed.load (std::memory_order_acquire) != b.size)
+              std::this_thread::yield();
+
+            submit (next % slots.size(), b);
+            ++next;
+            ++inFlight;
+          }
+
+          if (inFlight > 0) {
+            reap (true, inFlight);
+            continue;
+          }
+
+          std::unique_lock lock { mutex };
+          const auto ticket { flushRequested };
+          const bool stopping { stop };
+          if (ticket == flushed && !stopping) {
+            cv.wait_for (lock, flushInterval, [ this, next ] () {
+              return stop || flushRequested != flushed || slots[next % slots.size()].status.load (std::memory_order_acquire) == Status::kSealed;
+            });
+          }
+          lock.unlock();
+
+          // nothing in flight: seal the current buffer if it holds lines
+          const auto c { current.load (std::memory_order_acquire) };
+          if (c == next) {
+            auto &b { slots[c % slots.size()] };
+            auto w { b.reserved.load (std::memory_order_acquire) };
+            if ((w & kOffsetMask) != 0) {
+              if (!(w & kSealed) && b.reserved.compare_exchange_strong (w, w | kSealed, std::memory_order_acq_rel))
+                seal (c, w & kOffsetMask);
+              continue;
+            }
+          }
+          else {
+            continue;
+          }
+
+          lock.lock();
+          if (ticket != flushed) {
+            flushed = ticket;
+            flushedCv.notify_all();
+          }
+          if (stopping)
+            return;
+        }
+      }
+
+      void submit (std::size_t index, Buffer &b) {
+        CXXLOG_PROBE1 (file_submit, b.size);
+        b.status.store (Status::kInFlight, std::memory_order_relaxed);
+        const auto at { offset };
+        offset += b.size;
+
+#ifdef CXXLOG_HAS_IO_URING
+        if (ring && ring->write (fd, static_cast<unsigned> (index), b.data.get(), b.size, at)) {
+          pending[index] = at;
+          return;
+        }
+#endif
+
+        writeAll (b.data.get(), b.size, at);
+        complete (b);
+      }
+
+      void reap ([[maybe_unused]] bool wait, std::size_t &inFlight) {
+#ifdef CXXLOG_HAS_IO_URING
+        if (ring) {
+          ring->reap (wait, [ this, &inFlight ] (unsigned index, int res) {
+            auto &b { slots[index] };
+
+            // finish short or interrupted writes synchronously
+            if (res == -EINTR || res == -EAGAIN)
+              res = 0;
+            if (res >= 0 && static_cast<std::size_t> (res) < b.size)
+              writeAll (b.data.get() + res, b.size - static_cast<std::size_t> (res), pending[index] + static_cast<std::uint64_t> (res));
+
+            complete (b);
+            --inFlight;
+          });
+
+          return;
+        }
+#endif
+
+        inFlight = 0;
+      }
+
+      // Makes a written buffer available for the generation it will serve next.
+      void complete (Buffer &b) {
+        b.generation += slots.size();
+        b.committed.store (0, std::memory_order_relaxed);
+        b.reserved.store (word (b.generation, 0), std::memory_order_release);
+        b.status.store (Status::kFree, std::memory_order_release);
+
+        // the producers waiting in seal() check the status under the mutex
+        {
+          const std::lock_guard lock { mutex };
+        }
+        freedCv.notify_all();
+      }
+
+      bool writeAll (const char *data, std::size_t size, std::uint64_t at) {
+        while (size > 0) {
+          const auto r { ::pwrite (fd, data, size, static_cast<off_t> (at)) };
+          if (r < 0) {
+            if (errno == EINTR)
+              continue;
+            return false;
+          }
+
+          data += r;
+          size -= static_cast<std::size_t> (r);
+          at += static_cast<std::uint64_t> (r);
+        }
+
+        return true;
+      }
+
+      int fd { -1 };
+      std::size_t capacity;
+      std::chrono::milliseconds flushInterval;
+      std::uint64_t offset { 0 };
+      std::vector<Buffer> slots;
+      std::atomic<std::size_t> current { 0 };
+
+      std::mutex mutex {};
+      std::condition_variable cv {};
+      std::condition_variable flushedCv {};
+      std::condition_variable freedCv {};
+      std::uint64_t flushRequested { 0 };
+      std::uint64_t flushed { 0 };
+      bool stop { false };
+
+#ifdef CXXLOG_HAS_IO_URING
+      std::unique_ptr<detail::Uring> ring {};
+      std::vector<std::uint64_t> pending = std::vector<std::uint64_t> (slots.size());
+#endif
+
+      std::thread worker {};
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+/// A BasicAsyncFile writing lines with the default layout.
+using AsyncFile = BasicAsyncFile<>;
+
+}
+
+#endif
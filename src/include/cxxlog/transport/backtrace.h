@@ -0,0 +1,260 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_TRANSPORT_BACKTRACE_H__
+#define __CXX_LOGGER_TRANSPORT_BACKTRACE_H__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <cxxlog/capture.h>
+#include <cxxlog/crash.h>
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog::transport {
+
+/// @class Backtrace
+/// @brief A wrapper which holds the log calls below the Logger severity threshold and passes
+/// them to a transport only when an error happens.
+///
+/// The calls the Logger is not enabled for are kept, without formatting them, in a bounded
+/// buffer of the thread which made them (see Capturing). When that thread logs a message at
+/// Severity::kError or above, its buffered calls are passed to the wrapped transport first,
+/// oldest first, followed by the message; the buffer is then emptied. The other messages the
+/// Logger is enabled for are passed through as they are. When a buffer is full, the oldest call
+/// is discarded:
+///
+/// @code
+///   const cxxlog::Logger<Backtrace<OutputStream>> logger { Severity::kWarn };
+///   logger.transport (Backtrace<OutputStream> { OutputStream { std::cerr }, 32 });
+/// @endcode
+///
+/// The buffers are per thread, so the wrapper must see the log calls on the thread which makes
+/// them: wrap an Async transport with Backtrace, not the other way around. The buffer of a
+/// thread is released, with the calls it still holds, when the thread exits. The wrapper
+/// exposes the `layout_type` of the wrapped transport, if any.
+///
+/// A CrashHandler watching the wrapper writes the calls held for the crashing thread if the
+/// process crashes.
+///
+/// Copies of a Backtrace wrapper share the same buffers.
+///
+/// @tparam T The Loggable transport type to wrap.
+template<Loggable T>
+class Backtrace: public cxxlog::detail::LayoutTraits<T> {
+  public:
+    /// Log calls below the Logger threshold are captured.
+    static constexpr bool kCaptureAll { true };
+
+    /// Default number of calls held per thread.
+    static constexpr std::size_t kDefaultEntries { 64 };
+
+    /// Default size in bytes of a held call.
+    static constexpr std::size_t kDefaultEntrySize { 256 };
+
+    /// Lowest severity level which emits the held calls.
+    static constexpr Severity kTrigger { Severity::kError };
+
+    /// @brief Constructor for the Backtrace class.
+    /// @param transport The transport to which log messages are passed.
+    /// @param entries Maximum number of calls held per thread.
+    /// @param entrySize Size in bytes of a held call, including a small header. Longer messages
+    /// are truncated.
+    Backtrace (T transport, std::size_t entries = kDefaultEntries, std::size_t entrySize = kDefaultEntrySize):
+      _state { std::make_shared<State> (std::move (transport), entries, entrySize) }
+    {
+      // empty
+    }
+
+    /// @brief Log a message with a specified severity level and timestamp.
+    /// @param msg The message to be logged.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    void log (const std::string &msg, Severity s, std::chrono::milliseconds ts) const {
+      log (Record { msg, s, ts });
+    }
+
+    /// @brief Log a record, preceded by the calls held for the current thread if its severity
+    /// level is kTrigger or above.
+    /// @param record The log record.
+    void log (const Record &record) const {
+      if (record.severity() >= kTrigger)
+        _state->local().emit (_state->transport);
+
+      cxxlog::detail::deliver (_state->transport, record);
+    }
+
+    /// @brief Holds a log call below the Logger threshold without formatting it.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    /// @param fmt The format string.
+    /// @param args The format arguments followed by the structured fields.
+    template<typename... Args>
+    void capture (Severity s, std::chrono::milliseconds ts, std::string_view fmt, const Args &... args) const {
+      auto &buffer { _state->local() };
+      const auto size { cxxlog::detail::CapturedCall::capture (buffer.next(), _state->entrySize, s, ts, fmt, args...) };
+      if (size != 0)
+        buffer.commit (size);
+    }
+
+    /// @brief Writes the calls held for the current thread to a file descriptor, using only
+    /// async-signal-safe operations (see CrashHandler). The messages held by the wrapped
+    /// transport, if it is CrashDumpable, are written first.
+    /// @param out The writer of the file descriptor.
+    void crashDump (cxxlog::detail::RawWriter &out) const noexcept {
+      if constexpr (CrashDumpable<T>)
+        _state->transport.crashDump (out);
+
+      if (auto *buffer { _state->cached() })
+        buffer->crashDump (out);
+    }
+
+    /// @brief Flushes the wrapped transport if it provides a `flush()` method. The held calls
+    /// are not emitted.
+    void flush () const {
+      if constexpr (requires { _state->transport.flush(); })
+        _state->transport.flush();
+    }
+
+    /// @brief Gets the number of threads which have a buffer of held calls.
+    /// @return The number of buffers.
+    std::size_t threads () const {
+      const std::lock_guard lock { _state->mutex };
+      return _state->buffers.size();
+    }
+
+  private:
+    // Ring of held calls of one thread; only that thread uses it.
+    class Buffer {
+      public:
+        Buffer (std::size_t entries, std::size_t entrySize):
+          _entrySize { entrySize },
+          _data (entries * entrySize),
+          _sizes (entries)
+        {
+          // empty
+        }
+
+        char * next () noexcept { return &_data[((_first + _count) % _sizes.size()) * _entrySize]; }
+
+        void commit (std::size_t size) noexcept {
+          _sizes[(_first + _count) % _sizes.size()] = size;
+          if (_count < _sizes.size())
+            ++_count;
+          else
+            _first = (_first + 1) % _sizes.size();
+        }
+
+        void emit (const T &transport) {
+          for (; _count > 0; --_count, _first = (_first + 1) % _sizes.size()) {
+            const auto *entry { &_data[_first * _entrySize] };
+            cxxlog::detail::deliver (transport, cxxlog::detail::CapturedCall::decode (entry, _sizes[_first]));
+          }
+
+          _first = 0;
+        }
+
+        void crashDump (cxxlog::detail::RawWriter &out) const noexcept {
+          for (std::size_t i = 0; i < _count; ++i)
+            cxxlog::detail::CapturedCall::write (&_data[((_first + i) % _sizes.size()) * _entrySize], out);
+        }
+
+      private:
+        std::size_t _entrySize;
+        std::vector<char> _data;
+        std::vector<std::size_t> _sizes;
+        std::size_t _first { 0 };
+        std::size_t _count { 0 };
+    };
+
+    struct State: std::enable_shared_from_this<State> {
+      State (T &&t, std::size_t e, std::size_t size):
+        transport { std::move (t) },
+        entries { std::max<std::size_t> (e, 1) },
+        entrySize { std::max (size, cxxlog::detail::CapturedCall::kHeaderSize + 2 * sizeof (std::uint32_t)) }
+      {
+        // empty
+      }
+
+      // the states a thread has a buffer in, whose buffers are released when the thread exits
+      struct Owners {
+        std::vector<std::weak_ptr<State>> states {};
+
+        ~Owners () {
+          for (const auto &state: states) {
+            if (const auto s { state.lock() })
+              s->release();
+          }
+        }
+      };
+
+      static Owners & owners () {
+        thread_local Owners o {};
+        return o;
+      }
+
+      // The buffer of the calling thread, if it is in the per-thread cache of the last states
+      // used.
+      Buffer * cached () const noexcept { return cxxlog::detail::ThreadCache<Buffer>::find (id); }
+
+      // The buffer of the calling thread.
+      Buffer & local () {
+        if (auto *buffer { cached() })
+          return *buffer;
+
+        const std::lock_guard lock { mutex };
+        auto &buffer { buffers[std::this_thread::get_id()] };
+        if (!buffer) {
+          buffer = std::make_unique<Buffer> (entries, entrySize);
+
+          auto &states { owners().states };
+          std::erase_if (states, [] (const auto &state) { return state.expired(); });
+          states.push_back (this->weak_from_this());
+        }
+
+        cxxlog::detail::ThreadCache<Buffer>::insert (id, buffer.get());
+        return *buffer;
+      }
+
+      // Releases the buffer of the calling thread.
+      void release () {
+        cxxlog::detail::ThreadCache<Buffer>::erase (id);
+
+        const std::lock_guard lock { mutex };
+        buffers.erase (std::this_thread::get_id());
+      }
+
+      // identifies the state in the thread caches, where its address could be reused
+      static std::uint64_t nextId () noexcept {
+        static std::atomic<std::uint64_t> counter { 0 };
+        return counter.fetch_add (1, std::memory_order_relaxed) + 1;
+      }
+
+      T transport;
+      const std::size_t entries;
+      const std::size_t entrySize;
+      const std::uint64_t id { nextId() };
+
+      std::mutex mutex {};
+      std::map<std::thread::id, std::unique_ptr<Buffer>> buffers {};
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+}
+
+#endif
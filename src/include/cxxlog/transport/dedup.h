@@ -0,0 +1,199 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_TRANSPORT_DEDUP_H__
+#define __CXX_LOGGER_TRANSPORT_DEDUP_H__
+
+#include <chrono>
+#include <cinttypes>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog::transport {
+
+/// @class Dedup
+/// @brief A wrapper which collapses consecutive identical messages, like syslog.
+///
+/// A message with the same severity level, text and fields as the previous one is not passed to
+/// the wrapped transport; it is counted instead. When a different message arrives, or when a
+/// repeated message comes in more than `timeout` after the first one held back, the transport
+/// receives a summary line with the severity level of the repeated message:
+///
+/// @code
+///   2023-09-02T10:00:00 E: connect failed: refused
+///   2023-09-02T10:00:05 E: last message repeated 4999 times
+///   2023-09-02T10:00:05 I: reconnected
+/// @endcode
+///
+/// Messages are compared by a 64-bit hash of their text and fields first; on a match, the text
+/// and fields of the previous message, which the wrapper keeps, are compared too, so a hash
+/// collision never drops a different message. The timeout is checked when a message arrives:
+/// there is no timer, so the summary of the repeats which end a burst is only written when the
+/// next message arrives or when the wrapper is flushed. Flush it periodically if the stream may
+/// stay idle after a burst.
+///
+/// @code
+///   const cxxlog::Logger<Dedup<OutputStream>> logger {};
+///   logger.transport (Dedup<OutputStream> { OutputStream { std::cerr } });
+/// @endcode
+///
+/// Messages are compared across all the threads, in the order they reach the wrapper, which
+/// passes them on under a lock. Wrap an Async transport with Dedup, not the other way around,
+/// so the lock is only held to enqueue. The wrapper exposes the `layout_type` of the wrapped
+/// transport, if any.
+///
+/// Copies of a Dedup wrapper share the same state.
+///
+/// @tparam T The Loggable transport type to wrap.
+template<Loggable T>
+class Dedup: public cxxlog::detail::LayoutTraits<T> {
+  public:
+    /// Default time after which repeats are summarized even if the message doesn't change.
+    static constexpr std::chrono::milliseconds kDefaultTimeout { 30000 };
+
+    /// @brief Constructor for the Dedup class.
+    /// @param transport The transport to which log messages are passed.
+    /// @param timeout Time after which the repeats of a message are summarized anyway.
+    Dedup (T transport, std::chrono::milliseconds timeout = kDefaultTimeout):
+      _state { std::make_shared<State> (std::move (transport), timeout) }
+    {
+      // empty
+    }
+
+    /// @brief Log a message with a specified severity level and timestamp.
+    /// @param msg The message to be logged.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    void log (const std::string &msg, Severity s, std::chrono::milliseconds ts) const {
+      log (Record { msg, s, ts });
+    }
+
+    /// @brief Log a record, unless it repeats the previous one.
+    /// @param record The log record.
+    void log (const Record &record) const {
+      const auto hash { State::digest (record) };
+
+      const std::lock_guard lock { _state->mutex };
+
+      if (hash == _state->hash && record.severity() == _state->severity && _state->previous && State::same (record, *_state->previous)) {
+        if (_state->repeats == 0)
+          _state->since = record.timestamp();
+
+        ++_state->repeats;
+        _state->last = record.timestamp();
+        _state->thread = record.thread();
+
+        if (record.timestamp() - _state->since >= _state->timeout)
+          _state->summarize();
+
+        return;
+      }
+
+      _state->summarize();
+      cxxlog::detail::deliver (_state->transport, record);
+
+      _state->hash = hash;
+      _state->severity = record.severity();
+      _state->previous = record;
+    }
+
+    /// @brief Passes the summary of the pending repeats, if any, to the wrapped transport, then
+    /// flushes it if it provides a `flush()` method.
+    void flush () const {
+      {
+        const std::lock_guard lock { _state->mutex };
+        _state->summarize();
+      }
+
+      if constexpr (requires { _state->transport.flush(); })
+        _state->transport.flush();
+    }
+
+    /// @brief Gets the number of repeats held back so far and not summarized yet.
+    /// @return The number of pending repeats.
+    std::uint64_t pending () const {
+      const std::lock_guard lock { _state->mutex };
+      return _state->repeats;
+    }
+
+  private:
+    struct State {
+      State (T &&t, std::chrono::milliseconds timeout):
+        transport { std::move (t) },
+        timeout { timeout }
+      {
+        // empty
+      }
+
+      static std::uint64_t digest (const Record &record) noexcept {
+        auto h { std::hash<std::string_view> {} (record.message()) };
+        const auto combine { [ &h ] (std::size_t v) { h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2); } };
+
+        for (const auto &field: record.fields()) {
+          combine (std::hash<std::string_view> {} (field.key));
+          combine (field.value.index());
+          std::visit ([ &combine ] (const auto &v) {
+            if constexpr (std::is_same_v<std::decay_t<decltype (v)>, std::string>)
+              combine (std::hash<std::string_view> {} (v));
+            else
+              combine (std::hash<std::decay_t<decltype (v)>> {} (v));
+          }, field.value);
+        }
+
+        return h;
+      }
+
+      static bool same (const Record &a, const Record &b) noexcept {
+        if (a.message() != b.message() || a.fields().size() != b.fields().size())
+          return false;
+
+        for (std::size_t i = 0; i < a.fields().size(); ++i) {
+          if (a.fields()[i].key != b.fields()[i].key || a.fields()[i].value != b.fields()[i].value)
+            return false;
+        }
+
+        return true;
+      }
+
+      // Called with the mutex held.
+      void summarize () {
+        if (repeats == 0)
+          return;
+
+        const auto count { std::exchange (repeats, 0) };
+        cxxlog::detail::deliver (transport, Record {
+          "last message repeated " + std::to_string (count) + (count == 1 ? " time" : " times"), severity, last, {}, thread
+        });
+      }
+
+      T transport;
+      const std::chrono::milliseconds timeout;
+
+      std::mutex mutex {};
+      std::uint64_t hash { 0 };
+      Severity severity { Severity::kNone };
+      std::optional<Record> previous {};
+      std::uint64_t repeats { 0 };
+      std::chrono::milliseconds since { 0 };
+      std::chrono::milliseconds last { 0 };
+      std::uint64_t thread { 0 };
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+}
+
+#endif
@@ -0,0 +1,446 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_TRANSPORT_FD_H__
+#define __CXX_LOGGER_TRANSPORT_FD_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <climits>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cxxlog/layout.h>
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog::transport {
+
+/// @cond Doxygen_Suppress
+namespace detail {
+  /// Maximum number of iovecs accepted by a single writev call.
+#ifdef IOV_MAX
+  inline constexpr std::size_t kMaxIov { IOV_MAX };
+#else
+  inline constexpr std::size_t kMaxIov { 1024 };
+#endif
+
+  /// Opens a log file for appending. Throws std::system_error on failure.
+  inline int openAppend (const std::filesystem::path &path) {
+    const int fd { ::open (path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644) };
+    if (fd < 0)
+      throw std::system_error { errno, std::generic_category(), "cannot open " + path.string() };
+
+    return fd;
+  }
+
+  /// Writes the whole iovec array to fd, resuming after short writes. Returns false on error.
+  inline bool writeFully (int fd, struct iovec *iov, std::size_t count) noexcept {
+    while (count > 0) {
+      const auto r { ::writev (fd, iov, static_cast<int> (std::min (count, kMaxIov))) };
+      if (r < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+
+      auto written { static_cast<std::size_t> (r) };
+      while (count > 0 && written >= iov->iov_len) {
+        written -= iov->iov_len;
+        ++iov;
+        --count;
+      }
+
+      if (count > 0) {
+        iov->iov_base = static_cast<char *> (iov->iov_base) + written;
+        iov->iov_len -= written;
+      }
+    }
+
+    return true;
+  }
+
+  /// Writes the iovec array to fd, issuing a single writev call unless the kernel writes it partially.
+  inline bool writeOnce (int fd, struct iovec *iov, std::size_t count) noexcept {
+    ssize_t r;
+    do {
+      r = ::writev (fd, iov, static_cast<int> (count));
+    } while (r < 0 && errno == EINTR);
+
+    if (r < 0)
+      return false;
+
+    auto written { static_cast<std::size_t> (r) };
+    while (count > 0 && written >= iov->iov_len) {
+      written -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+
+    if (count == 0)
+      return true;
+
+    iov->iov_base = static_cast<char *> (iov->iov_base) + written;
+    iov->iov_len -= written;
+
+    return writeFully (fd, iov, count);
+  }
+}
+/// @endcond
+
+/// @class BasicBatchedFile
+/// @brief A class for logging messages to a file descriptor in batches.
+///
+/// Formatted lines are collected in a batch buffer, one iovec per line, and the batch is
+/// written with a single `writev(2)` call when it reaches the byte limit or the line limit, when
+/// it has been pending for the maximum delay, or when flush() is called. A background thread,
+/// which only wakes up while a batch is pending, writes the batches which reach the maximum
+/// delay in a quiet process. Pending lines are also written when the last copy of the transport
+/// is destroyed.
+///
+/// A batch only ever contains complete lines, so several processes can share a file opened with
+/// `O_APPEND` (which is how the path constructor opens it): each batch lands at the end of the
+/// file without being interleaved with another writer's lines.
+/// Log lines are written with the layout L, by default the same as OutputStream: "<timestamp> <severity>: <message>\n".
+///
+/// Copies of a BatchedFile share the same batch and file descriptor.
+///
+/// @tparam L The layout of the log lines (e.g. a PatternLayout).
+template<Layout L = DefaultLayout>
+class BasicBatchedFile {
+  public:
+    /// The layout of the log lines, rendered once per record by the Logger.
+    using layout_type = L;
+
+    /// Default byte limit of a batch (64 KiB).
+    static constexpr std::size_t kDefaultMaxBytes { 64u << 10 };
+    /// Default line limit of a batch.
+    static constexpr std::size_t kDefaultMaxLines { 256 };
+    /// Default maximum time a line stays in the batch.
+    static constexpr std::chrono::milliseconds kDefaultMaxDelay { 100 };
+
+    /// @brief Constructor for the BatchedFile class.
+    /// @param path File to which log messages will be appended. It is created if it doesn't exist.
+    /// @param maxBytes Byte limit of a batch.
+    /// @param maxLines Line limit of a batch.
+    /// @param maxDelay Maximum time a line stays in the batch.
+    /// @throw std::system_error if the file can't be opened.
+    BasicBatchedFile (
+      const std::filesystem::path &path,
+      std::size_t maxBytes = kDefaultMaxBytes,
+      std::size_t maxLines = kDefaultMaxLines,
+      std::chrono::milliseconds maxDelay = kDefaultMaxDelay
+    ):
+      _state { std::make_shared<State> (detail::openAppend (path), true, maxBytes, maxLines, maxDelay) }
+    {
+      // empty
+    }
+
+    /// @brief Constructor for the BatchedFile class.
+    /// @param fd File descriptor to which log messages will be written. It is not closed by the transport.
+    /// @param maxBytes Byte limit of a batch.
+    /// @param maxLines Line limit of a batch.
+    /// @param maxDelay Maximum time a line stays in the batch.
+    BasicBatchedFile (
+      int fd,
+      std::size_t maxBytes = kDefaultMaxBytes,
+      std::size_t maxLines = kDefaultMaxLines,
+      std::chrono::milliseconds maxDelay = kDefaultMaxDelay
+    ):
+      _state { std::make_shared<State> (fd, false, maxBytes, maxLines, maxDelay) }
+    {
+      // empty
+    }
+
+    /// @brief Log a message with a specified severity level and timestamp.
+    /// @param msg The message to be logged.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    void log (const std::string &msg, Severity s, std::chrono::milliseconds ts) const {
+      log (Record::View { msg, s, ts });
+    }
+
+    /// @brief Log a record.
+    /// @param record The log record.
+    void log (const Record &record) const {
+      thread_local std::string scratch {};
+      _state->append (record.parts<layout_type> (scratch), record.message());
+    }
+
+    /// @brief Writes the pending lines.
+    void flush () const {
+      std::lock_guard lock { _state->mutex };
+      _state->write();
+    }
+
+  private:
+    struct State {
+      State (int f, bool owned, std::size_t bytes, std::size_t lines, std::chrono::milliseconds delay):
+        fd { f },
+        ownsFd { owned },
+        maxBytes { std::max<std::size_t> (bytes, 1) },
+        maxLines { std::clamp<std::size_t> (lines, 1, detail::kMaxIov) },
+        maxDelay { delay },
+        arena { std::make_unique<char[]> (maxBytes) }
+      {
+        iov.reserve (maxLines);
+        flusher = std::thread { [ this ] () { run(); } };
+      }
+
+      ~State () {
+        {
+          const std::lock_guard lock { mutex };
+          stop = true;
+        }
+
+        wake.notify_one();
+        flusher.join();
+
+        write();
+
+        if (ownsFd)
+          ::close (fd);
+      }
+
+      void append (const Record::Parts &parts, std::string_view msg) {
+        const auto n { parts.prefix.size() + msg.size() + parts.suffix.size() };
+        const auto now { std::chrono::steady_clock::now() };
+
+        std::lock_guard lock { mutex };
+
+        if (used + n > maxBytes)
+          write();
+
+        if (n > maxBytes) {
+          // too long to be batched: written on its own without copying the message
+          struct iovec line[3] {
+            { const_cast<char *> (parts.prefix.data()), parts.prefix.size() },
+            { const_cast<char *> (msg.data()), msg.size() },
+            { const_cast<char *> (parts.suffix.data()), parts.suffix.size() }
+          };
+          detail::writeFully (fd, line, 3);
+          return;
+        }
+
+        if (iov.empty()) {
+          oldest = now;
+          wake.notify_one();
+        }
+
+        auto *p { arena.get() + used };
+        std::memcpy (p, parts.prefix.data(), parts.prefix.size());
+        std::memcpy (p + parts.prefix.size(), msg.data(), msg.size());
+        std::memcpy (p + parts.prefix.size() + msg.size(), parts.suffix.data(), parts.suffix.size());
+
+        iov.push_back ({ p, n });
+        used += n;
+
+        if (iov.size() >= maxLines || used >= maxBytes || now - oldest >= maxDelay)
+          write();
+      }
+
+      // Writes the batches which have been pending for the maximum delay.
+      void run () {
+        std::unique_lock lock { mutex };
+
+        while (!stop) {
+          if (iov.empty()) {
+            wake.wait (lock);
+            continue;
+          }
+
+          const auto deadline { oldest + maxDelay };
+          if (std::chrono::steady_clock::now() >= deadline)
+            write();
+          else
+            wake.wait_until (lock, deadline);
+        }
+      }
+
+      // Writes the batch. Must be called with the mutex held.
+      void write () {
+        if (!iov.empty())
+          detail::writeFully (fd, iov.data(), iov.size());
+
+        iov.clear();
+        used = 0;
+      }
+
+      int fd;
+      bool ownsFd;
+      std::size_t maxBytes;
+      std::size_t maxLines;
+      std::chrono::milliseconds maxDelay;
+      std::unique_ptr<char[]> arena;
+      std::size_t used { 0 };
+      std::vector<struct iovec> iov {};
+      std::chrono::steady_clock::time_point oldest {};
+      std::mutex mutex {};
+      std::condition_variable wake {};
+      bool stop { false };
+      std::thread flusher {};
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+/// A BasicBatchedFile writing lines with the default layout.
+using BatchedFile = BasicBatchedFile<>;
+
+/// @class BasicAppendFile
+/// @brief A class for logging messages to a file shared by several processes.
+///
+/// The file is opened with `O_APPEND` and every log line reaches the kernel in a single
+/// `writev(2)` call (the timestamp, the message and the line feed are gathered without being
+/// copied), so lines written by different processes are never interleaved and no lock is needed.
+///
+/// Lines longer than the atomic size are split into several lines, each of them written with its
+/// own call and no longer than the atomic size. Every part carries a continuation marker with the
+/// process id, a per-transport record number and the part number, so the record can be put back
+/// together even when other processes write in between:
+/// "<timestamp> <severity>: [<pid>.<record> <part>/<parts>] <fragment>\n"
+///
+/// Short log lines are written with the layout L, by default the same as OutputStream: "<timestamp> <severity>: <message>\n".
+///
+/// Copies of an AppendFile share the same file descriptor.
+///
+/// @tparam L The layout of the log lines (e.g. a PatternLayout).
+template<Layout L = DefaultLayout>
+class BasicAppendFile {
+  public:
+    /// The layout of the log lines, rendered once per record by the Logger.
+    using layout_type = L;
+
+    /// Default atomic size: the largest write POSIX guarantees to be atomic on pipes.
+#ifdef PIPE_BUF
+    static constexpr std::size_t kDefaultAtomicSize { PIPE_BUF };
+#else
+    static constexpr std::size_t kDefaultAtomicSize { 4096 };
+#endif
+    /// Smallest accepted atomic size.
+    static constexpr std::size_t kMinAtomicSize { 128 };
+
+    /// @brief Constructor for the AppendFile class.
+    /// @param path File to which log messages will be appended. It is created if it doesn't exist.
+    /// @param atomicSize Maximum size of a line written with a single call.
+    /// @throw std::system_error if the file can't be opened.
+    BasicAppendFile (const std::filesystem::path &path, std::size_t atomicSize = kDefaultAtomicSize):
+      _state { std::make_shared<State> (detail::openAppend (path), true, atomicSize) }
+    {
+      // empty
+    }
+
+    /// @brief Constructor for the AppendFile class.
+    /// @param fd File descriptor to which log messages will be written. It should have been opened
+    ///           with `O_APPEND` and it is not closed by the transport.
+    /// @param atomicSize Maximum size of a line written with a single call.
+    BasicAppendFile (int fd, std::size_t atomicSize = kDefaultAtomicSize):
+      _state { std::make_shared<State> (fd, false, atomicSize) }
+    {
+      // empty
+    }
+
+    /// @brief Log a message with a specified severity level and timestamp.
+    /// @param msg The message to be logged.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    void log (const std::string &msg, Severity s, std::chrono::milliseconds ts) const {
+      log (Record::View { msg, s, ts });
+    }
+
+    /// @brief Log a record.
+    /// @param record The log record.
+    void log (const Record &record) const {
+      thread_local std::string scratch {};
+      const auto [ prefix, suffix ] { record.parts<layout_type> (scratch) };
+      const auto &msg { record.message() };
+
+      if (prefix.size() + msg.size() + suffix.size() <= _state->atomicSize) {
+        struct iovec line[3] {
+          { const_cast<char *> (prefix.data()), prefix.size() },
+          { const_cast<char *> (msg.data()), msg.size() },
+          { const_cast<char *> (suffix.data()), suffix.size() }
+        };
+        detail::writeOnce (_state->fd, line, 3);
+        return;
+      }
+
+      // layouts with a long prefix still make progress, even if the lines exceed the atomic size
+      const auto overhead { prefix.size() + kMaxMarkerSize + suffix.size() };
+      const auto fragmentSize { _state->atomicSize > overhead ? _state->atomicSize - overhead : kMinAtomicSize };
+      const auto pid { static_cast<long> (::getpid()) };
+      const auto id { _state->records.fetch_add (1, std::memory_order_relaxed) };
+      const auto parts { (msg.size() + fragmentSize - 1) / fragmentSize };
+
+      for (std::size_t part = 0; part < parts; ++part) {
+        char marker[kMaxMarkerSize + 1];
+        const auto markerSize {
+          std::snprintf (marker, sizeof (marker), "[%ld.%" PRIu64 " %zu/%zu] ", pid, id, part + 1, parts)
+        };
+        const auto offset { part * fragmentSize };
+
+        struct iovec line[4] {
+          { const_cast<char *> (prefix.data()), prefix.size() },
+          { marker, static_cast<std::size_t> (markerSize) },
+          { const_cast<char *> (msg.data() + offset), std::min (fragmentSize, msg.size() - offset) },
+          { const_cast<char *> (suffix.data()), suffix.size() }
+        };
+        detail::writeOnce (_state->fd, line, 4);
+      }
+    }
+
+    /// @brief Gets the maximum size of a line written with a single call.
+    /// @return The atomic size in bytes.
+    std::size_t atomicSize () const noexcept { return _state->atomicSize; }
+
+  private:
+    // "[<pid>.<record> <part>/<parts>] " with 20 digits for each number
+    static constexpr std::size_t kMaxMarkerSize { 1 + 20 + 1 + 20 + 1 + 20 + 1 + 20 + 2 };
+
+    struct State {
+      State (int f, bool owned, std::size_t size):
+        fd { f },
+        ownsFd { owned },
+        atomicSize { std::max (size, kMinAtomicSize) }
+      {
+        // empty
+      }
+
+      ~State () {
+        if (ownsFd)
+          ::close (fd);
+      }
+
+      int fd;
+      bool ownsFd;
+      std::size_t atomicSize;
+      std::atomic<std::uint64_t> records { 0 };
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+/// A BasicAppendFile writing lines with the default layout.
+using AppendFile = BasicAppendFile<>;
+
+}
+
+#endif
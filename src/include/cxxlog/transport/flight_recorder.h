@@ -0,0 +1,265 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_TRANSPORT_FLIGHT_RECORDER_H__
+#define __CXX_LOGGER_TRANSPORT_FLIGHT_RECORDER_H__
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <bit>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cxxlog/capture.h>
+#include <cxxlog/crash.h>
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog::transport {
+
+/// @class FlightRecorder
+/// @brief A transport which keeps the last log calls of every severity level in memory and
+/// passes them to another transport when a fatal message is logged or on request.
+///
+/// The recorder captures the calls below the Logger severity threshold too (see Capturing),
+/// without formatting them: the format string and the arguments are copied into a fixed-size
+/// slot of a lock-free ring, and the message is only formatted if the ring is dumped. Arguments
+/// which can't be copied as raw bytes (anything but numbers, strings and fields) make the call
+/// be formatted straight away instead. When the ring is full the oldest calls are overwritten.
+///
+/// @code
+///   const cxxlog::Logger<OutputStream, FlightRecorder<FileStream>> logger { Severity::kWarning };
+///   logger.transport (OutputStream { std::cerr });
+///   logger.transport (FlightRecorder<FileStream> { FileStream { "crash.log" } });
+/// @endcode
+///
+/// A call which doesn't fit in its slot is kept with its message truncated. Calls whose slot is
+/// still being written by a slower thread when the ring wraps around are dropped.
+///
+/// A CrashHandler watching the recorder writes the calls stored since the last dump if the
+/// process crashes.
+///
+/// Copies of a FlightRecorder share the same ring.
+///
+/// @tparam T The Loggable transport type which receives the dumped calls.
+template<Loggable T>
+class FlightRecorder {
+  public:
+    /// Log calls below the Logger threshold are captured.
+    static constexpr bool kCaptureAll { true };
+
+    /// Default number of slots of the ring.
+    static constexpr std::size_t kDefaultEntries { 4096 };
+
+    /// Default slot size in bytes.
+    static constexpr std::size_t kDefaultEntrySize { 256 };
+
+    /// @brief Constructor for the FlightRecorder class.
+    /// @param transport The transport to which the captured calls are dumped.
+    /// @param entries Number of slots of the ring. It is rounded up to a power of two.
+    /// @param entrySize Size of each slot in bytes, including a small header.
+    FlightRecorder (T transport, std::size_t entries = kDefaultEntries, std::size_t entrySize = kDefaultEntrySize):
+      _state { std::make_shared<State> (std::move (transport), entries, entrySize) }
+    {
+      // empty
+    }
+
+    /// @brief Stores a message with a specified severity level and timestamp.
+    /// @param msg The message to be logged.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    void log (const std::string &msg, Severity s, std::chrono::milliseconds ts) const {
+      log (Record { msg, s, ts });
+    }
+
+    /// @brief Stores a record. A fatal record dumps the ring.
+    /// @param record The log record.
+    void log (const Record &record) const {
+      _state->push ([ &record ] (char *buf, std::size_t capacity) {
+        return cxxlog::detail::CapturedCall::store (buf, capacity, record);
+      });
+
+      if (record.severity() == Severity::kFatal)
+        _state->dump();
+    }
+
+    /// @brief Stores a log call below the Logger threshold without formatting it.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    /// @param fmt The format string.
+    /// @param args The format arguments followed by the structured fields.
+    template<typename... Args>
+    void capture (Severity s, std::chrono::milliseconds ts, std::string_view fmt, const Args &... args) const {
+      _state->push ([ & ] (char *buf, std::size_t capacity) {
+        return cxxlog::detail::CapturedCall::capture (buf, capacity, s, ts, fmt, args...);
+      });
+    }
+
+    /// @brief Passes the calls stored since the previous dump to the transport, oldest first, then
+    /// flushes the transport if it provides a `flush()` method.
+    void dump () const { _state->dump(); }
+
+    /// @brief Writes the calls stored since the previous dump to a file descriptor, using only
+    /// async-signal-safe operations (see CrashHandler).
+    /// @param out The writer of the file descriptor.
+    void crashDump (cxxlog::detail::RawWriter &out) const noexcept { _state->crashDump (out); }
+
+    /// @brief Gets the number of calls dropped because their slot was busy.
+    /// @return The number of dropped calls.
+    std::uint64_t dropped () const noexcept { return _state->dropped.load (std::memory_order_relaxed); }
+
+    /// @brief Gets the number of slots of the ring.
+    /// @return The maximum number of stored calls.
+    std::size_t capacity () const noexcept { return _state->mask + 1; }
+
+    /// @brief Gets the function which reads the dropped counter of the recorder for Metrics. It
+    /// only keeps a weak reference to the ring.
+    /// @return The function filling the dropped counter.
+    std::function<void (Metrics::TransportStats &)> probe () const {
+      return [ weak = std::weak_ptr<State> { _state } ] (Metrics::TransportStats &stats) {
+        if (const auto state { weak.lock() })
+          stats.dropped = state->dropped.load (std::memory_order_relaxed);
+      };
+    }
+
+  private:
+    // Each slot is a seqlock: its sequence is 2 * pos + 1 while the call at position pos is being
+    // written and 2 * pos + 2 once it is complete. The payload is stored in atomic words so a dump
+    // racing with a writer reads a torn slot (and discards it) instead of undefined behavior.
+    struct State {
+      State (T &&t, std::size_t entries, std::size_t entrySize):
+        transport { std::move (t) },
+        mask { std::bit_ceil (std::max<std::size_t> (entries, 2)) - 1 },
+        words { (std::max (entrySize, kMinEntrySize) + sizeof (std::uint64_t) - 1) / sizeof (std::uint64_t) },
+        sequences { std::make_unique<std::atomic<std::uint64_t>[]> (mask + 1) },
+        sizes { std::make_unique<std::atomic<std::uint32_t>[]> (mask + 1) },
+        data { std::make_unique<std::atomic<std::uint64_t>[]> ((mask + 1) * words) }
+      {
+        // empty
+      }
+
+      template<typename F>
+      void push (F &&encode) {
+        thread_local std::vector<std::uint64_t> scratch {};
+        scratch.resize (words);
+
+        auto *buf { reinterpret_cast<char *> (scratch.data()) };
+        const auto size { encode (buf, words * sizeof (std::uint64_t)) };
+        if (size == 0) {
+          dropped.fetch_add (1, std::memory_order_relaxed);
+          return;
+        }
+
+        const auto pos { head.fetch_add (1, std::memory_order_relaxed) };
+        const auto slot { pos & mask };
+
+        auto seq { sequences[slot].load (std::memory_order_relaxed) };
+        if ((seq & 1) || seq > 2 * pos || !sequences[slot].compare_exchange_strong (seq, 2 * pos + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+          dropped.fetch_add (1, std::memory_order_relaxed);
+          return;
+        }
+
+        auto *dst { &data[slot * words] };
+        const auto used { (size + sizeof (std::uint64_t) - 1) / sizeof (std::uint64_t) };
+        for (std::size_t i = 0; i < used; ++i)
+          dst[i].store (scratch[i], std::memory_order_release);
+
+        sizes[slot].store (static_cast<std::uint32_t> (size), std::memory_order_release);
+        sequences[slot].store (2 * pos + 2, std::memory_order_release);
+      }
+
+      // Copies the complete call at position pos into entry; returns its size, or 0 if the slot
+      // holds another call or was overwritten while it was being copied.
+      std::size_t read (std::uint64_t pos, std::uint64_t *entry, std::size_t capacity) const noexcept {
+        const auto slot { pos & mask };
+        if (sequences[slot].load (std::memory_order_acquire) != 2 * pos + 2)
+          return 0;
+
+        const auto size { std::min<std::size_t> (sizes[slot].load (std::memory_order_acquire), words * sizeof (std::uint64_t)) };
+        if (size > capacity * sizeof (std::uint64_t))
+          return 0;
+
+        const auto *src { &data[slot * words] };
+        for (std::size_t i = 0; i < (size + sizeof (std::uint64_t) - 1) / sizeof (std::uint64_t); ++i)
+          entry[i] = src[i].load (std::memory_order_acquire);
+
+        return sequences[slot].load (std::memory_order_relaxed) == 2 * pos + 2 ? size : 0;
+      }
+
+      // First position which may hold a call not dumped yet.
+      std::uint64_t first (std::uint64_t last) const noexcept {
+        return std::max (dumped.load (std::memory_order_relaxed), last > mask ? last - mask - 1 : 0);
+      }
+
+      void dump () {
+        const std::lock_guard lock { mutex };
+
+        std::vector<std::uint64_t> entry (words);
+        const auto last { head.load (std::memory_order_acquire) };
+
+        for (auto pos = first (last); pos < last; ++pos) {
+          const auto size { read (pos, entry.data(), words) };
+          if (size == 0)
+            continue;
+
+          try {
+            cxxlog::detail::deliver (transport, cxxlog::detail::CapturedCall::decode (reinterpret_cast<const char *> (entry.data()), size));
+          }
+          catch (...) {
+            // a failing transport must not stop the dump
+          }
+        }
+
+        dumped.store (last, std::memory_order_relaxed);
+
+        if constexpr (requires { transport.flush(); })
+          transport.flush();
+      }
+
+      void crashDump (cxxlog::detail::RawWriter &out) const noexcept {
+        std::uint64_t entry[kMaxCrashEntrySize / sizeof (std::uint64_t)];
+
+        const auto last { head.load (std::memory_order_acquire) };
+        for (auto pos = first (last); pos < last; ++pos) {
+          if (read (pos, entry, std::size (entry)) != 0)
+            cxxlog::detail::CapturedCall::write (reinterpret_cast<const char *> (entry), out);
+        }
+      }
+
+      // larger calls are skipped by crashDump(), which can't allocate
+      static constexpr std::size_t kMaxCrashEntrySize { 4096 };
+
+      // room for the header and an empty message
+      static constexpr std::size_t kMinEntrySize { cxxlog::detail::CapturedCall::kHeaderSize + 2 * sizeof (std::uint32_t) };
+
+      T transport;
+      const std::size_t mask;
+      const std::size_t words;
+      std::unique_ptr<std::atomic<std::uint64_t>[]> sequences;
+      std::unique_ptr<std::atomic<std::uint32_t>[]> sizes;
+      std::unique_ptr<std::atomic<std::uint64_t>[]> data;
+
+      alignas (64) std::atomic<std::uint64_t> head { 0 };
+      alignas (64) std::atomic<std::uint64_t> dropped { 0 };
+
+      std::mutex mutex {};
+      std::atomic<std::uint64_t> dumped { 0 };
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+}
+
+#endif
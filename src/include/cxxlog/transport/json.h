@@ -0,0 +1,250 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_TRANSPORT_JSON_H__
+#define __CXX_LOGGER_TRANSPORT_JSON_H__
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#elif defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+#include <cxxlog/layout.h>
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog::transport {
+
+/// @cond Doxygen_Suppress
+namespace detail {
+  /// For every byte, the character following the backslash when it must be escaped in a JSON
+  /// string ('u' for the "\u00XX" form), or 0 if it is copied as is.
+  inline constexpr auto kJsonEscape { [] () {
+    std::array<char, 256> table {};
+    for (int c = 0; c < 0x20; ++c)
+      table[static_cast<std::size_t> (c)] = 'u';
+
+    table['\b'] = 'b';
+    table['\t'] = 't';
+    table['\n'] = 'n';
+    table['\f'] = 'f';
+    table['\r'] = 'r';
+    table['"'] = '"';
+    table['\\'] = '\\';
+
+    return table;
+  } () };
+
+  /// Appends the escaped form of the character @p c to @p out.
+  inline void escapeJsonChar (std::string &out, unsigned char c) {
+    constexpr char kHex[] { "0123456789abcdef" };
+
+    const char e { kJsonEscape[c] };
+    if (e == 'u') {
+      const char seq[6] { '\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0x0F] };
+      out.append (seq, sizeof (seq));
+    }
+    else {
+      const char seq[2] { '\\', e };
+      out.append (seq, sizeof (seq));
+    }
+  }
+
+  /// Appends @p s to @p out escaped as the contents of a JSON string, one byte at a time.
+  inline void escapeJsonScalar (std::string &out, std::string_view s) {
+    std::size_t clean { 0 };
+    for (std::size_t i = 0; i < s.size(); ++i) {
+      const auto c { static_cast<unsigned char> (s[i]) };
+      if (kJsonEscape[c]) {
+        out.append (s.data() + clean, i - clean);
+        escapeJsonChar (out, c);
+        clean = i + 1;
+      }
+    }
+
+    out.append (s.data() + clean, s.size() - clean);
+  }
+
+  /// Appends @p s to @p out escaped as the contents of a JSON string.
+  ///
+  /// With SSE2 (16 bytes) or AVX2 (32 bytes) available at compile time, blocks of the input are
+  /// checked for quotes, backslashes and control characters at once, and runs of clean blocks
+  /// are copied with a single append. The tail, and targets without those instruction sets, go
+  /// through escapeJsonScalar().
+  inline void escapeJson (std::string &out, std::string_view s) {
+    const char *p { s.data() };
+    const char *end { p + s.size() };
+
+#if defined(__AVX2__)
+    constexpr std::size_t kBlock { 32 };
+    const auto quote { _mm256_set1_epi8 ('"') };
+    const auto backslash { _mm256_set1_epi8 ('\\') };
+    const auto control { _mm256_set1_epi8 (0x1F) };
+
+    // bit i is set if byte i of the block must be escaped
+    const auto scan { [ & ] (const char *block) {
+      const auto v { _mm256_loadu_si256 (reinterpret_cast<const __m256i *> (block)) };
+      const auto special {
+        _mm256_or_si256 (
+          _mm256_or_si256 (_mm256_cmpeq_epi8 (v, quote), _mm256_cmpeq_epi8 (v, backslash)),
+          _mm256_cmpeq_epi8 (_mm256_min_epu8 (v, control), v)
+        )
+      };
+      return static_cast<std::uint32_t> (_mm256_movemask_epi8 (special));
+    } };
+#elif defined(__SSE2__)
+    constexpr std::size_t kBlock { 16 };
+    const auto quote { _mm_set1_epi8 ('"') };
+    const auto backslash { _mm_set1_epi8 ('\\') };
+    const auto control { _mm_set1_epi8 (0x1F) };
+
+    // bit i is set if byte i of the block must be escaped
+    const auto scan { [ & ] (const char *block) {
+      const auto v { _mm_loadu_si128 (reinterpret_cast<const __m128i *> (block)) };
+      const auto special {
+        _mm_or_si128 (
+          _mm_or_si128 (_mm_cmpeq_epi8 (v, quote), _mm_cmpeq_epi8 (v, backslash)),
+          _mm_cmpeq_epi8 (_mm_min_epu8 (v, control), v)
+        )
+      };
+      return static_cast<std::uint32_t> (_mm_movemask_epi8 (special));
+    } };
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    const char *clean { p };
+    while (static_cast<std::size_t> (end - p) >= kBlock) {
+      auto mask { scan (p) };
+      if (mask == 0) {
+        p += kBlock;
+        continue;
+      }
+
+      // copy the clean run up to each special byte of the block, then escape it
+      while (mask != 0) {
+        const auto *special { p + std::countr_zero (mask) };
+        out.append (clean, static_cast<std::size_t> (special - clean));
+        escapeJsonChar (out, static_cast<unsigned char> (*special));
+        clean = special + 1;
+        mask &= mask - 1;
+      }
+
+      p += kBlock;
+    }
+
+    out.append (clean, static_cast<std::size_t> (p - clean));
+#endif
+
+    escapeJsonScalar (out, { p, static_cast<std::size_t> (end - p) });
+  }
+
+  /// Appends @p s to @p out as a quoted JSON string.
+  inline void appendJsonString (std::string &out, std::string_view s) {
+    out += '"';
+    escapeJson (out, s);
+    out += '"';
+  }
+
+  /// Appends a field value to @p out as a JSON value. Non-finite numbers are written as null.
+  inline void appendJsonValue (std::string &out, const FieldValue &value) {
+    std::visit ([ &out ] (const auto &v) {
+      using V = std::decay_t<decltype (v)>;
+
+      if constexpr (std::is_same_v<V, bool>) {
+        out += v ? "true" : "false";
+      }
+      else if constexpr (std::is_same_v<V, std::string>) {
+        appendJsonString (out, v);
+      }
+      else {
+        if constexpr (std::is_same_v<V, double>) {
+          if (!std::isfinite (v)) {
+            out += "null";
+            return;
+          }
+        }
+
+        char buf[32];
+        out.append (buf, std::to_chars (buf, buf + sizeof (buf), v).ptr);
+      }
+    }, value);
+  }
+}
+/// @endcond
+
+/// @class JsonStream
+/// @brief A class for logging messages to an output stream as JSON lines.
+///
+/// Every log record is written as a single JSON object followed by a line feed:
+/// `{"ts":"2001-04-19T04:25:21.042Z","sev":"I","msg":"...","<key>":<value>,...}`
+///
+/// The timestamp is UTC with millisecond resolution and the structured fields of the record
+/// follow the message as members of the same object, keeping their JSON type. Strings are
+/// escaped with SSE2 or AVX2 when the compiler targets them (e.g. `-mavx2`), copying runs of
+/// characters which need no escaping at once. Each line is built in a per-thread buffer and
+/// written to the stream with a single call.
+class JsonStream {
+  public:
+    /// @brief Constructor for the JsonStream class.
+    /// @param out The output stream to which log lines will be written.
+    JsonStream (std::ostream &out): _out { out } {
+      // empty
+    }
+
+    /// @brief Log a message with a specified severity level and timestamp.
+    /// @param msg The message to be logged.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    void log (const std::string &msg, Severity s, std::chrono::milliseconds ts) const {
+      log (Record::View { msg, s, ts });
+    }
+
+    /// @brief Log a record.
+    /// @param record The log record.
+    void log (const Record &record) const {
+      thread_local std::string line {};
+      line.clear();
+
+      line += "{\"ts\":\"";
+      cxxlog::detail::appendIsoTime (line, record.timestamp());
+      line += "\",\"sev\":\"";
+      line += Logger<>::toCString (record.severity());
+      line += "\",\"msg\":\"";
+      detail::escapeJson (line, record.message());
+      line += '"';
+
+      for (const auto &field: record.fields()) {
+        line += ',';
+        detail::appendJsonString (line, field.key);
+        line += ':';
+        detail::appendJsonValue (line, field.value);
+      }
+
+      line += "}\n";
+
+      _out.get().write (line.data(), static_cast<std::streamsize> (line.size()));
+    }
+
+  private:
+    std::reference_wrapper<std::ostream> _out;
+};
+
+}
+
+#endif
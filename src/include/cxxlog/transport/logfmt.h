@@ -0,0 +1,103 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_TRANSPORT_LOGFMT_H__
+#define __CXX_LOGGER_TRANSPORT_LOGFMT_H__
+
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include <cxxlog/layout.h>
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog::transport {
+
+/// @cond Doxygen_Suppress
+namespace detail {
+  /// The constant text between the timestamp and the message of each severity level.
+  inline constexpr std::array<std::string_view, 6> kLogfmtLevels {
+    " level=trace msg=",
+    " level=debug msg=",
+    " level=info msg=",
+    " level=warn msg=",
+    " level=error msg=",
+    " level=fatal msg="
+  };
+
+  /// Appends " <key>=" to @p out, replacing the characters a key can't contain with '_'.
+  inline void appendLogfmtKey (std::string &out, std::string_view key) {
+    out += ' ';
+    const auto start { out.size() };
+    out += key.empty() ? std::string_view { "_" } : key;
+
+    for (auto i = start; i < out.size(); ++i) {
+      if (cxxlog::detail::kTextClasses[static_cast<unsigned char> (out[i])] & cxxlog::detail::kTextQuote)
+        out[i] = '_';
+    }
+
+    out += '=';
+  }
+}
+/// @endcond
+
+/// @class LogfmtStream
+/// @brief A class for logging messages to an output stream in the logfmt format.
+///
+/// Every log record is written as a line of space separated key-value pairs:
+/// `ts=2001-04-19T04:25:21.042Z level=info msg="request done" status=200`
+///
+/// The timestamp is UTC with millisecond resolution, the levels are `trace` (verbose), `debug`,
+/// `info`, `warn`, `error` and `fatal`, and the structured fields of the record follow the
+/// message. Values are quoted only when they need it, which a character class table decides in
+/// a single pass, and the constant text around the level is precomputed. Each line is built in
+/// a per-thread buffer and written to the stream with a single call.
+class LogfmtStream {
+  public:
+    /// @brief Constructor for the LogfmtStream class.
+    /// @param out The output stream to which log lines will be written.
+    LogfmtStream (std::ostream &out): _out { out } {
+      // empty
+    }
+
+    /// @brief Log a message with a specified severity level and timestamp.
+    /// @param msg The message to be logged.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    void log (const std::string &msg, Severity s, std::chrono::milliseconds ts) const {
+      log (Record::View { msg, s, ts });
+    }
+
+    /// @brief Log a record.
+    /// @param record The log record.
+    void log (const Record &record) const {
+      thread_local std::string line {};
+      line.assign ("ts=");
+
+      cxxlog::detail::appendIsoTime (line, record.timestamp());
+      line += detail::kLogfmtLevels[static_cast<std::size_t> (record.severity())];
+      cxxlog::detail::appendQuotedString (line, record.message());
+
+      for (const auto &field: record.fields()) {
+        detail::appendLogfmtKey (line, field.key);
+        cxxlog::detail::appendFieldValue (line, field.value);
+      }
+
+      line += '\n';
+
+      _out.get().write (line.data(), static_cast<std::streamsize> (line.size()));
+    }
+
+  private:
+    std::reference_wrapper<std::ostream> _out;
+};
+
+}
+
+#endif
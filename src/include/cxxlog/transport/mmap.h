@@ -0,0 +1,272 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_TRANSPORT_MMAP_H__
+#define __CXX_LOGGER_TRANSPORT_MMAP_H__
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cxxlog/layout.h>
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog::transport {
+
+/// @class BasicMappedFile
+/// @brief A class for logging messages to a file through a shared memory mapping.
+///
+/// The file is grown in fixed-size segments which are preallocated on disk and mapped into
+/// memory. Writing a log line reserves its byte range by atomically advancing a tail offset and
+/// copies the formatted line straight into the mapping, so the calling thread never issues a
+/// `write(2)`; the kernel writes dirty pages back asynchronously.
+///
+/// A segment is unmapped by the writer that completes its last byte. When the transport is
+/// destroyed, the file is truncated to the logged data so no preallocated space is left behind.
+/// The lines falling in a segment which can't be preallocated or mapped (e.g. on ENOSPC) are
+/// dropped; that range of the file is filled with blank lines when the transport is destroyed.
+/// Log lines are written with the layout L, by default the same as OutputStream: "<timestamp> <severity>: <message>\n".
+///
+/// Copies of a MappedFile share the same underlying file and mapping.
+///
+/// @tparam L The layout of the log lines (e.g. a PatternLayout).
+template<Layout L = DefaultLayout>
+class BasicMappedFile {
+  public:
+    /// The layout of the log lines, rendered once per record by the Logger.
+    using layout_type = L;
+
+    /// Default segment size (32 MiB).
+    static constexpr std::size_t kDefaultSegmentSize { 32u << 20 };
+
+    /// @brief Constructor for the MappedFile class.
+    /// @param path File to which log messages will be appended. It is created if it doesn't exist.
+    /// @param segmentSize Size of each preallocated segment. It is rounded up to the page size.
+    /// @throw std::system_error if the file can't be opened.
+    BasicMappedFile (const std::filesystem::path &path, std::size_t segmentSize = kDefaultSegmentSize):
+      _state { std::make_shared<State> (path, segmentSize) }
+    {
+      // empty
+    }
+
+    /// @brief Log a message with a specified severity level and timestamp.
+    /// @param msg The message to be logged.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    ///
+    /// @note If a segment can't be preallocated or mapped the line is dropped.
+    void log (const std::string &msg, Severity s, std::chrono::milliseconds ts) const {
+      log (Record::View { msg, s, ts });
+    }
+
+    /// @brief Log a record.
+    /// @param record The log record.
+    ///
+    /// @note If a segment can't be preallocated or mapped the line is dropped.
+    void log (const Record &record) const {
+      thread_local std::string scratch {};
+      const auto parts { record.parts<layout_type> (scratch) };
+      const auto &msg { record.message() };
+
+      auto off { _state->tail.fetch_add (parts.prefix.size() + msg.size() + parts.suffix.size(), std::memory_order_relaxed) };
+      off = _state->copy (off, parts.prefix.data(), parts.prefix.size());
+      off = _state->copy (off, msg.data(), msg.size());
+      _state->copy (off, parts.suffix.data(), parts.suffix.size());
+    }
+
+    /// @brief Gets the size of the segments in which the file is preallocated.
+    /// @return The segment size in bytes.
+    std::size_t segmentSize () const noexcept { return _state->segmentSize; }
+
+  private:
+    struct State {
+      static constexpr std::size_t kSlots { 4 };
+      static constexpr std::uint64_t kNoSegment { std::numeric_limits<std::uint64_t>::max() };
+
+      // A mapped segment. The slot of segment k is slots[k % kSlots].
+      struct Slot {
+        std::atomic<std::uint64_t> segment { kNoSegment };
+        std::atomic<std::uint64_t> committed { 0 };
+        char *base { nullptr };
+      };
+
+      State (const std::filesystem::path &path, std::size_t size) {
+        const auto page { static_cast<std::size_t> (::sysconf (_SC_PAGESIZE)) };
+        segmentSize = std::max<std::size_t> ((size + page - 1) / page * page, page);
+
+        fd = ::open (path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+          throw std::system_error { errno, std::generic_category(), "cannot open " + path.string() };
+
+        struct stat st {};
+        ::fstat (fd, &st);
+        start = static_cast<std::uint64_t> (st.st_size);
+        tail.store (start, std::memory_order_relaxed);
+      }
+
+      ~State () {
+        for (auto &slot: slots) {
+          if (slot.segment.load (std::memory_order_relaxed) != kNoSegment && slot.base)
+            ::munmap (slot.base, segmentSize);
+        }
+
+        const auto end { tail.load (std::memory_order_relaxed) };
+        [[maybe_unused]] auto r { ::ftruncate (fd, static_cast<off_t> (end)) };
+        fillDropped (end);
+        ::close (fd);
+      }
+
+      // Copies [data, data + n) to the file offset off, crossing segments if needed.
+      // Returns the offset following the copied bytes.
+      std::uint64_t copy (std::uint64_t off, const char *data, std::size_t n) {
+        while (n > 0) {
+          const auto segment { off / segmentSize };
+          const auto pos { off % segmentSize };
+          const auto chunk { std::min<std::size_t> (n, segmentSize - pos) };
+
+          auto &slot { slots[segment % kSlots] };
+          if (slot.segment.load (std::memory_order_acquire) != segment)
+            map (segment);
+
+          // a segment which couldn't be mapped has no base: its bytes are dropped, but still
+          // counted so the slot is released for the later segments
+          if (slot.base)
+            std::memcpy (slot.base + pos, data, chunk);
+
+          // the writer completing the segment is the last one touching it
+          if (slot.committed.fetch_add (chunk, std::memory_order_acq_rel) + chunk == segmentSize) {
+            if (slot.base)
+              ::munmap (slot.base, segmentSize);
+            slot.segment.store (kNoSegment, std::memory_order_release);
+          }
+
+          off += chunk;
+          data += chunk;
+          n -= chunk;
+        }
+
+        return off;
+      }
+
+      // Preallocates and maps a segment into its slot. If the segment can't be mapped, the slot
+      // holds it with no base and the segment is recorded as dropped.
+      void map (std::uint64_t segment) {
+        auto &slot { slots[segment % kSlots] };
+
+        std::unique_lock lock { mutex };
+        for (;;) {
+          const auto current { slot.segment.load (std::memory_order_acquire) };
+          if (current == segment)
+            return;
+          if (current == kNoSegment)
+            break;
+
+          // a writer is still copying into an older segment sharing this slot
+          lock.unlock();
+          std::this_thread::yield();
+          lock.lock();
+        }
+
+        auto *base { allocate (segment) };
+        if (!base)
+          dropped.push_back (segment);
+
+        // bytes already in the file before it was opened are never copied by this process
+        const auto first { start / segmentSize };
+        slot.base = base;
+        slot.committed.store (segment == first ? start % segmentSize : 0, std::memory_order_relaxed);
+        slot.segment.store (segment, std::memory_order_release);
+      }
+
+      // Preallocates and maps a segment. Returns nullptr if it can't be done (e.g. ENOSPC).
+      char * allocate (std::uint64_t segment) {
+        const auto offset { static_cast<off_t> (segment * segmentSize) };
+#ifdef __linux__
+        if (::fallocate (fd, 0, offset, static_cast<off_t> (segmentSize)) != 0) {
+          // only grow a sparse file when the filesystem can't preallocate: after ENOSPC its pages
+          // would have no backing, and the first write into them would raise SIGBUS
+          if (errno != EOPNOTSUPP && errno != ENOSYS)
+            return nullptr;
+          if (::ftruncate (fd, offset + static_cast<off_t> (segmentSize)) != 0)
+            return nullptr;
+        }
+#else
+        struct stat st {};
+        if (::fstat (fd, &st) != 0)
+          return nullptr;
+        if (st.st_size < offset + static_cast<off_t> (segmentSize) &&
+            ::ftruncate (fd, offset + static_cast<off_t> (segmentSize)) != 0)
+          return nullptr;
+#endif
+
+        void *base { ::mmap (nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset) };
+        return base == MAP_FAILED ? nullptr : static_cast<char *> (base);
+      }
+
+      // Overwrites the bytes of the dropped segments, which would otherwise read as NULs, with
+      // blank lines.
+      void fillDropped (std::uint64_t end) {
+        for (const auto segment: dropped) {
+          const auto from { std::max (segment * segmentSize, start) };
+          const auto to { std::min ((segment + 1) * segmentSize, end) };
+          if (from >= to)
+            continue;
+
+          std::string filler (static_cast<std::size_t> (to - from), ' ');
+          filler.back() = '\n';
+
+          const auto *p { filler.data() };
+          auto left { filler.size() };
+          auto at { static_cast<off_t> (from) };
+          while (left > 0) {
+            const auto r { ::pwrite (fd, p, left, at) };
+            if (r < 0 && errno == EINTR)
+              continue;
+            if (r <= 0)
+              break;
+
+            p += r;
+            left -= static_cast<std::size_t> (r);
+            at += r;
+          }
+        }
+      }
+
+      int fd { -1 };
+      std::size_t segmentSize { 0 };
+      std::uint64_t start { 0 };
+      std::atomic<std::uint64_t> tail { 0 };
+      std::array<Slot, kSlots> slots {};
+      std::mutex mutex {};
+      std::vector<std::uint64_t> dropped {};
+    };
+
+    std::shared_ptr<State> _state;
+};
+
+/// A BasicMappedFile writing lines with the default layout.
+using MappedFile = BasicMappedFile<>;
+
+}
+
+#endif
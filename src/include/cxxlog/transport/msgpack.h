@@ -0,0 +1,409 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_TRANSPORT_MSGPACK_H__
+#define __CXX_LOGGER_TRANSPORT_MSGPACK_H__
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cinttypes>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include <cxxlog/logger.h>
+
+
+namespace cxxlog::transport {
+
+/// @cond Doxygen_Suppress
+namespace detail {
+  /// Appends MessagePack values to a buffer, always with the shortest encoding.
+  class MsgPackWriter {
+    public:
+      MsgPackWriter (std::string &out): _out { out } {
+        // empty
+      }
+
+      void raw (std::string_view bytes) { _out += bytes; }
+
+      void boolean (bool v) { _out += static_cast<char> (v ? 0xC3 : 0xC2); }
+
+      void uint (std::uint64_t v) {
+        if (v < 0x80)
+          _out += static_cast<char> (v);
+        else if (v <= std::numeric_limits<std::uint8_t>::max())
+          bigEndian<std::uint8_t> (0xCC, v);
+        else if (v <= std::numeric_limits<std::uint16_t>::max())
+          bigEndian<std::uint16_t> (0xCD, v);
+        else if (v <= std::numeric_limits<std::uint32_t>::max())
+          bigEndian<std::uint32_t> (0xCE, v);
+        else
+          bigEndian<std::uint64_t> (0xCF, v);
+      }
+
+      void sint (std::int64_t v) {
+        if (v >= 0)
+          uint (static_cast<std::uint64_t> (v));
+        else if (v >= -32)
+          _out += static_cast<char> (v);
+        else if (v >= std::numeric_limits<std::int8_t>::min())
+          bigEndian<std::uint8_t> (0xD0, static_cast<std::uint64_t> (v));
+        else if (v >= std::numeric_limits<std::int16_t>::min())
+          bigEndian<std::uint16_t> (0xD1, static_cast<std::uint64_t> (v));
+        else if (v >= std::numeric_limits<std::int32_t>::min())
+          bigEndian<std::uint32_t> (0xD2, static_cast<std::uint64_t> (v));
+        else
+          bigEndian<std::uint64_t> (0xD3, static_cast<std::uint64_t> (v));
+      }
+
+      void float64 (double v) { bigEndian<std::uint64_t> (0xCB, std::bit_cast<std::uint64_t> (v)); }
+
+      void str (std::string_view s) {
+        if (s.size() < 32)
+          _out += static_cast<char> (0xA0 | s.size());
+        else if (s.size() <= std::numeric_limits<std::uint8_t>::max())
+          bigEndian<std::uint8_t> (0xD9, s.size());
+        else if (s.size() <= std::numeric_limits<std::uint16_t>::max())
+          bigEndian<std::uint16_t> (0xDA, s.size());
+        else
+          bigEndian<std::uint32_t> (0xDB, s.size());
+
+        _out += s;
+      }
+
+      void map (std::size_t size) {
+        if (size < 16)
+          _out += static_cast<char> (0x80 | size);
+        else if (size <= std::numeric_limits<std::uint16_t>::max())
+          bigEndian<std::uint16_t> (0xDE, size);
+        else
+          bigEndian<std::uint32_t> (0xDF, size);
+      }
+
+      void value (const FieldValue &value) {
+        std::visit ([ this ] (const auto &v) {
+          using V = std::decay_t<decltype (v)>;
+
+          if constexpr (std::is_same_v<V, bool>)
+            boolean (v);
+          else if constexpr (std::is_same_v<V, std::int64_t>)
+            sint (v);
+          else if constexpr (std::is_same_v<V, std::uint64_t>)
+            uint (v);
+          else if constexpr (std::is_same_v<V, double>)
+            float64 (v);
+          else
+            str (v);
+        }, value);
+      }
+
+    private:
+      template<typename T>
+      void bigEndian (std::uint8_t tag, std::uint64_t v) {
+        char buf[1 + sizeof (T)];
+        buf[0] = static_cast<char> (tag);
+        for (std::size_t i = 0; i < sizeof (T); ++i)
+          buf[1 + i] = static_cast<char> (v >> (8 * (sizeof (T) - 1 - i)));
+
+        _out.append (buf, sizeof (buf));
+      }
+
+      std::string &_out;
+  };
+
+  /// Reads the MessagePack values written by MsgPackWriter. Every method returns false (and the
+  /// reader stops making progress) if the input is malformed or truncated.
+  class MsgPackReader {
+    public:
+      MsgPackReader (std::string_view in): _in { in } {
+        // empty
+      }
+
+      std::string_view remaining () const noexcept { return _in; }
+
+      bool map (std::size_t &size) {
+        std::uint8_t tag;
+        if (!byte (tag))
+          return false;
+
+        if ((tag & 0xF0) == 0x80) {
+          size = tag & 0x0F;
+          return true;
+        }
+
+        std::uint64_t n;
+        if ((tag == 0xDE && bigEndian (2, n)) || (tag == 0xDF && bigEndian (4, n))) {
+          size = static_cast<std::size_t> (n);
+          return true;
+        }
+
+        return false;
+      }
+
+      bool str (std::string_view &s) {
+        std::uint8_t tag;
+        if (!byte (tag))
+          return false;
+
+        std::uint64_t n;
+        if ((tag & 0xE0) == 0xA0)
+          n = tag & 0x1F;
+        else if (!((tag == 0xD9 && bigEndian (1, n)) || (tag == 0xDA && bigEndian (2, n)) || (tag == 0xDB && bigEndian (4, n))))
+          return false;
+
+        if (n > _in.size())
+          return false;
+
+        s = _in.substr (0, static_cast<std::size_t> (n));
+        _in.remove_prefix (static_cast<std::size_t> (n));
+        return true;
+      }
+
+      bool value (FieldValue &value) {
+        if (_in.empty())
+          return false;
+
+        const auto tag { static_cast<std::uint8_t> (_in.front()) };
+        if (tag < 0x80 || (tag >= 0xCC && tag <= 0xCF)) {
+          std::uint64_t v;
+          if (!uint (v))
+            return false;
+
+          value = v;
+          return true;
+        }
+
+        if (tag >= 0xE0 || (tag >= 0xD0 && tag <= 0xD3)) {
+          _in.remove_prefix (1);
+
+          std::uint64_t v;
+          if (tag >= 0xE0)
+            v = static_cast<std::uint64_t> (static_cast<std::int8_t> (tag));
+          else if (!bigEndian (std::size_t { 1 } << (tag - 0xD0), v))
+            return false;
+
+          // sign extension of the narrower encodings
+          const auto bits { tag >= 0xE0 ? 64u : 8u << (tag - 0xD0) };
+          const auto shift { 64u - bits };
+          value = static_cast<std::int64_t> (v << shift) >> shift;
+          return true;
+        }
+
+        if (tag == 0xC2 || tag == 0xC3) {
+          _in.remove_prefix (1);
+          value = tag == 0xC3;
+          return true;
+        }
+
+        if (tag == 0xCB) {
+          _in.remove_prefix (1);
+
+          std::uint64_t v;
+          if (!bigEndian (8, v))
+            return false;
+
+          value = std::bit_cast<double> (v);
+          return true;
+        }
+
+        std::string_view s;
+        if (!str (s))
+          return false;
+
+        value = std::string { s };
+        return true;
+      }
+
+      bool uint (std::uint64_t &v) {
+        std::uint8_t tag;
+        if (!byte (tag))
+          return false;
+
+        if (tag < 0x80) {
+          v = tag;
+          return true;
+        }
+
+        return tag >= 0xCC && tag <= 0xCF && bigEndian (std::size_t { 1 } << (tag - 0xCC), v);
+      }
+
+      bool sint (std::int64_t &v) {
+        FieldValue value;
+        if (!this->value (value))
+          return false;
+
+        if (const auto *i { std::get_if<std::int64_t> (&value) }) {
+          v = *i;
+          return true;
+        }
+
+        if (const auto *u { std::get_if<std::uint64_t> (&value) }; u && *u <= static_cast<std::uint64_t> (std::numeric_limits<std::int64_t>::max())) {
+          v = static_cast<std::int64_t> (*u);
+          return true;
+        }
+
+        return false;
+      }
+
+    private:
+      bool byte (std::uint8_t &b) {
+        if (_in.empty())
+          return false;
+
+        b = static_cast<std::uint8_t> (_in.front());
+        _in.remove_prefix (1);
+        return true;
+      }
+
+      bool bigEndian (std::size_t size, std::uint64_t &v) {
+        if (_in.size() < size)
+          return false;
+
+        v = 0;
+        for (std::size_t i = 0; i < size; ++i)
+          v = (v << 8) | static_cast<std::uint8_t> (_in[i]);
+
+        _in.remove_prefix (size);
+        return true;
+      }
+
+      std::string_view _in;
+  };
+}
+/// @endcond
+
+/// @class MsgPackStream
+/// @brief A class for logging messages to an output stream encoded as MessagePack.
+///
+/// Every log record is written as a MessagePack map with four entries:
+/// - `"ts"`: Epoch time in milliseconds (integer).
+/// - `"sev"`: Severity level (integer, see Severity).
+/// - `"msg"`: The message (string).
+/// - `"fields"`: The structured fields of the record (map from name to boolean, integer,
+///   float or string).
+///
+/// Records are self-delimiting, so a stream of them needs no framing and can be read back with
+/// decode(). Each record is encoded into a per-thread buffer which is reused, so encoding doesn't
+/// allocate once the buffer has grown to the size of the largest record, and written to the
+/// stream with a single call.
+class MsgPackStream {
+  public:
+    /// @brief Constructor for the MsgPackStream class.
+    /// @param out The output stream to which records will be written. It should be opened in
+    ///            binary mode.
+    MsgPackStream (std::ostream &out): _out { out } {
+      // empty
+    }
+
+    /// @brief Log a message with a specified severity level and timestamp.
+    /// @param msg The message to be logged.
+    /// @param s The severity level of the message.
+    /// @param ts Epoch time in milliseconds.
+    void log (const std::string &msg, Severity s, std::chrono::milliseconds ts) const {
+      log (Record { msg, s, ts });
+    }
+
+    /// @brief Log a record.
+    /// @param record The log record.
+    void log (const Record &record) const {
+      thread_local std::string buffer {};
+      buffer.clear();
+
+      encode (buffer, record);
+
+      _out.get().write (buffer.data(), static_cast<std::streamsize> (buffer.size()));
+    }
+
+    /// @brief Appends the MessagePack encoding of a record to a buffer.
+    /// @param out The output buffer.
+    /// @param record The log record.
+    static void encode (std::string &out, const Record &record) {
+      detail::MsgPackWriter writer { out };
+
+      // map header and "ts" key
+      writer.raw ("\x84\xA2ts");
+      writer.sint (record.timestamp().count());
+      writer.raw ("\xA3sev");
+      writer.uint (static_cast<std::uint64_t> (record.severity()));
+      writer.raw ("\xA3msg");
+      writer.str (record.message());
+      writer.raw ("\xA6" "fields");
+      writer.map (record.fields().size());
+
+      for (const auto &field: record.fields()) {
+        writer.str (field.key);
+        writer.value (field.value);
+      }
+    }
+
+    /// @brief Decodes the record at the front of a buffer.
+    ///
+    /// The thread id of the decoded record is the one of the calling thread: it isn't encoded.
+    ///
+    /// @param in The encoded records. On success, the decoded record is removed from its front.
+    /// @return The record, or an empty optional if the buffer doesn't start with a complete and
+    ///         valid record.
+    static std::optional<Record> decode (std::string_view &in) {
+      detail::MsgPackReader reader { in };
+
+      std::size_t entries;
+      if (!reader.map (entries))
+        return std::nullopt;
+
+      std::int64_t ts { 0 };
+      std::uint64_t severity { static_cast<std::uint64_t> (Severity::kInfo) };
+      std::string_view msg {};
+      std::vector<Field> fields {};
+
+      for (std::size_t i = 0; i < entries; ++i) {
+        std::string_view key;
+        if (!reader.str (key))
+          return std::nullopt;
+
+        bool ok { false };
+        if (key == "ts") {
+          ok = reader.sint (ts);
+        }
+        else if (key == "sev") {
+          ok = reader.uint (severity) && severity <= static_cast<std::uint64_t> (Severity::kFatal);
+        }
+        else if (key == "msg") {
+          ok = reader.str (msg);
+        }
+        else if (key == "fields") {
+          std::size_t count;
+          ok = reader.map (count);
+
+          fields.reserve (std::min (count, reader.remaining().size()));
+          for (std::size_t f = 0; ok && f < count; ++f) {
+            std::string_view name;
+            auto &field { fields.emplace_back() };
+            ok = reader.str (name) && reader.value (field.value);
+            field.key = name;
+          }
+        }
+
+        if (!ok)
+          return std::nullopt;
+      }
+
+      in = reader.remaining();
+      return Record { std::string { msg }, static_cast<Severity> (severity), std::chrono::milliseconds { ts }, std::move (fields) };
+    }
+
+  private:
+    std::reference_wrapper<std::ostream> _out;
+};
+
+}
+
+#endif
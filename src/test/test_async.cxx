@@ -0,0 +1,211 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <atomic>
+#include <cinttypes>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/transport.h>
+#include <cxxlog/transport/async.h>
+
+
+// ----------------------------------------------------------------------------
+// Helpers
+// ----------------------------------------------------------------------------
+namespace {
+  // Records the messages it receives, optionally waiting on a gate before each one.
+  class Collector {
+    public:
+      struct Data {
+        std::mutex mutex {};
+        std::vector<std::string> messages {};
+        std::atomic<bool> open { true };
+        std::atomic<int> flushes { 0 };
+      };
+
+      Collector (Data &data): _data { data } {
+        // empty
+      }
+
+      void log (const std::string &msg, cxxlog::Severity, std::chrono::milliseconds) const {
+        while (!_data.get().open.load())
+          std::this_thread::yield();
+
+        std::lock_guard lock { _data.get().mutex };
+        _data.get().messages.push_back (msg);
+      }
+
+      void flush () const { ++_data.get().flushes; }
+
+    private:
+      std::reference_wrapper<Data> _data;
+  };
+}
+
+// ----------------------------------------------------------------------------
+// test_delivery_order
+// ----------------------------------------------------------------------------
+TEST (Async, test_delivery_order) {
+  Collector::Data data {};
+
+  const cxxlog::Logger<cxxlog::transport::Async<Collector>> logger { cxxlog::Severity::kVerbose };
+  logger.transport (cxxlog::transport::Async<Collector> { Collector { data }, 16 });
+
+  for (int i = 0; i < 1000; ++i)
+    logger.info ("message {}", i);
+
+  logger.flush();
+
+  ASSERT_EQ (data.messages.size(), 1000u);
+  for (int i = 0; i < 1000; ++i)
+    ASSERT_EQ (data.messages[static_cast<std::size_t> (i)], cxxlog::fmtlib::format ("message {}", i));
+
+  EXPECT_EQ (data.flushes.load(), 1);
+}
+
+// ----------------------------------------------------------------------------
+// test_slow_transport_does_not_stall
+// ----------------------------------------------------------------------------
+TEST (Async, test_slow_transport_does_not_stall) {
+  std::stringstream ss {};
+  Collector::Data data {};
+  data.open = false;
+
+  const cxxlog::Logger<cxxlog::transport::OutputStream, cxxlog::transport::Async<Collector>> logger { cxxlog::Severity::kVerbose };
+  logger.transport (cxxlog::transport::OutputStream { ss });
+  logger.transport (cxxlog::transport::Async<Collector> { Collector { data } });
+
+  // the collector is blocked, the output stream still gets every message
+  for (int i = 0; i < 10; ++i)
+    logger.info ("message {}", i);
+
+  EXPECT_NE (ss.str().find ("I: message 9\n"), std::string::npos);
+
+  data.open = true;
+  logger.flush();
+  EXPECT_EQ (data.messages.size(), 10u);
+}
+
+// ----------------------------------------------------------------------------
+// test_drop_newest
+// ----------------------------------------------------------------------------
+TEST (Async, test_drop_newest) {
+  Collector::Data data {};
+  data.open = false;
+
+  cxxlog::transport::Async<Collector> async { Collector { data }, 4, cxxlog::transport::Backpressure::kDropNewest };
+  EXPECT_EQ (async.capacity(), 4u);
+
+  // the worker may hold the first message while it waits for the gate
+  for (int i = 0; i < 10; ++i)
+    async.log (std::to_string (i), cxxlog::Severity::kInfo, std::chrono::milliseconds { 0 });
+
+  data.open = true;
+  async.flush();
+
+  EXPECT_EQ (data.messages.size() + async.dropped(), 10u);
+  EXPECT_GE (async.dropped(), 5u);
+  EXPECT_EQ (data.messages.front(), "0");
+}
+
+// ----------------------------------------------------------------------------
+// test_drop_oldest
+// ----------------------------------------------------------------------------
+TEST (Async, test_drop_oldest) {
+  Collector::Data data {};
+  data.open = false;
+
+  cxxlog::transport::Async<Collector> async { Collector { data }, 4, cxxlog::transport::Backpressure::kDropOldest };
+
+  for (int i = 0; i < 10; ++i)
+    async.log (std::to_string (i), cxxlog::Severity::kInfo, std::chrono::milliseconds { 0 });
+
+  data.open = true;
+  async.flush();
+
+  EXPECT_EQ (data.messages.size() + async.dropped(), 10u);
+  EXPECT_GE (async.dropped(), 5u);
+  EXPECT_EQ (data.messages.back(), "9");
+}
+
+// ----------------------------------------------------------------------------
+// test_multiple_producers
+// ----------------------------------------------------------------------------
+TEST (Async, test_multiple_producers) {
+  constexpr int kThreads { 4 };
+  constexpr int kMessages { 10000 };
+  Collector::Data data {};
+
+  {
+    const cxxlog::Logger<cxxlog::transport::Async<Collector>> logger { cxxlog::Severity::kVerbose };
+    logger.transport (cxxlog::transport::Async<Collector> { Collector { data }, 64 });
+
+    std::vector<std::thread> threads {};
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back ([ &logger, t ] () {
+        for (int i = 0; i < kMessages; ++i)
+          logger.debug ("{} {}", t, i);
+      });
+    }
+
+    for (auto &thread: threads)
+      thread.join();
+  }
+
+  // pending messages are delivered when the logger is destroyed
+  ASSERT_EQ (data.messages.size(), static_cast<std::size_t> (kThreads * kMessages));
+
+  std::vector<int> next (kThreads, 0);
+  for (const auto &msg: data.messages) {
+    int t { 0 };
+    int i { 0 };
+    ASSERT_EQ (std::sscanf (msg.c_str(), "%d %d", &t, &i), 2);
+    ASSERT_EQ (i, next[t]++);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// test_shared_record
+// ----------------------------------------------------------------------------
+TEST (Async, test_shared_record) {
+  class RecordCollector {
+    public:
+      using layout_type = cxxlog::DefaultLayout;
+
+      RecordCollector (std::vector<cxxlog::Record> &records): _records { records } {
+        // empty
+      }
+
+      void log (const cxxlog::Record &record) const { _records.get().push_back (record); }
+
+    private:
+      std::reference_wrapper<std::vector<cxxlog::Record>> _records;
+  };
+
+  static_assert (std::is_same_v<cxxlog::transport::Async<RecordCollector>::layout_type, cxxlog::DefaultLayout>);
+
+  std::vector<cxxlog::Record> direct {};
+  std::vector<cxxlog::Record> queued {};
+
+  const cxxlog::Logger<RecordCollector, cxxlog::transport::Async<RecordCollector>> logger { cxxlog::Severity::kVerbose };
+  logger.transport (RecordCollector { direct });
+  logger.transport (cxxlog::transport::Async<RecordCollector> { RecordCollector { queued } });
+
+  logger.info ("queued without a copy");
+  logger.flush();
+
+  // the background thread delivers the record created by the logger, layout included
+  ASSERT_EQ (direct.size(), 1u);
+  ASSERT_EQ (queued.size(), 1u);
+  EXPECT_EQ (&direct[0].message(), &queued[0].message());
+  EXPECT_TRUE (queued[0].rendered<cxxlog::DefaultLayout>());
+}
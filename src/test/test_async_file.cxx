@@ -0,0 +1,125 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <cinttypes>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/transport/async_file.h>
+
+#include "test_helpers.h"
+
+
+// ----------------------------------------------------------------------------
+// test_message_with_severity
+// ----------------------------------------------------------------------------
+TEST (AsyncFile, test_message_with_severity) {
+  const auto path { tempFile ("test_async_file_message_with_severity.log") };
+
+  std::ofstream { path } << "previous line\n";
+
+  cxxlog::transport::AsyncFile asyncFile { path };
+  asyncFile.log ("Test message", cxxlog::Severity::kInfo, std::chrono::milliseconds { 1234567890 });
+  asyncFile.log ("", cxxlog::Severity::kDebug, std::chrono::milliseconds { 1234567890 });
+  asyncFile.flush();
+
+  EXPECT_EQ (readFile (path), "previous line\n1970-01-15T06:56:07 I: Test message\n1970-01-15T06:56:07 D: \n");
+}
+
+// ----------------------------------------------------------------------------
+// test_flush_interval
+// ----------------------------------------------------------------------------
+TEST (AsyncFile, test_flush_interval) {
+  const auto path { tempFile ("test_async_file_flush_interval.log") };
+
+  cxxlog::transport::AsyncFile asyncFile { path, 4096, 2, std::chrono::milliseconds { 1 } };
+  asyncFile.log ("Test message", cxxlog::Severity::kError, std::chrono::milliseconds { 987654321000 });
+
+  for (int i = 0; i < 1000 && readFile (path).empty(); ++i)
+    std::this_thread::sleep_for (std::chrono::milliseconds { 5 });
+
+  EXPECT_EQ (readFile (path), "2001-04-19T04:25:21 E: Test message\n");
+}
+
+// ----------------------------------------------------------------------------
+// test_long_message
+// ----------------------------------------------------------------------------
+TEST (AsyncFile, test_long_message) {
+  const auto path { tempFile ("test_async_file_long_message.log") };
+
+  {
+    cxxlog::transport::AsyncFile asyncFile { path, 64, 2 };
+    asyncFile.log (std::string (100, 'x'), cxxlog::Severity::kInfo, std::chrono::milliseconds { 1234567890 });
+  }
+
+  EXPECT_EQ (readFile (path), "1970-01-15T06:56:07 I: " + std::string (40, 'x') + "\n");
+}
+
+// ----------------------------------------------------------------------------
+// test_multiple_threads
+// ----------------------------------------------------------------------------
+TEST (AsyncFile, test_multiple_threads) {
+  const auto path { tempFile ("test_async_file_multiple_threads.log") };
+  constexpr int kThreads { 4 };
+  constexpr int kLines { 5000 };
+
+  {
+    const cxxlog::Logger<cxxlog::transport::AsyncFile> logger { cxxlog::Severity::kVerbose };
+    logger.transport (cxxlog::transport::AsyncFile { path, 4096, 4 });
+
+    std::vector<std::thread> threads {};
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back ([ &logger, t ] () {
+        for (int i = 0; i < kLines; ++i)
+          logger.warn ("thread {} line {}", t, i);
+      });
+    }
+
+    for (auto &thread: threads)
+      thread.join();
+  }
+
+  std::vector<int> next (kThreads, 0);
+  std::istringstream lines { readFile (path) };
+  for (std::string line; std::getline (lines, line);) {
+    int t { 0 };
+    int i { 0 };
+    ASSERT_EQ (std::sscanf (line.c_str() + 19, " W: thread %d line %d", &t, &i), 2) << line;
+    ASSERT_EQ (i, next[t]++);
+  }
+
+  for (const auto n: next)
+    EXPECT_EQ (n, kLines);
+}
+
+// ----------------------------------------------------------------------------
+// test_full_buffers
+// ----------------------------------------------------------------------------
+TEST (AsyncFile, test_full_buffers) {
+  const auto path { tempFile ("test_async_file_full_buffers.log") };
+  constexpr int kLines { 2000 };
+
+  // every few lines fill both buffers: the writer waits for the background thread, which must
+  // be woken by the sealed buffers rather than by its flush interval
+  const auto start { std::chrono::steady_clock::now() };
+  {
+    cxxlog::transport::AsyncFile asyncFile { path, 256, 2, std::chrono::hours { 1 } };
+    for (int i = 0; i < kLines; ++i)
+      asyncFile.log ("line", cxxlog::Severity::kInfo, std::chrono::milliseconds { 0 });
+  }
+  EXPECT_LT (std::chrono::steady_clock::now() - start, std::chrono::seconds { 30 });
+
+  std::istringstream lines { readFile (path) };
+  int count { 0 };
+  for (std::string line; std::getline (lines, line); ++count)
+    ASSERT_EQ (line, "1970-01-01T00:00:00 I: line");
+  EXPECT_EQ (count, kLines);
+}
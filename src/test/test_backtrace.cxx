@@ -0,0 +1,102 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <cinttypes>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/transport/backtrace.h>
+
+#include "test_helpers.h"
+
+
+// ----------------------------------------------------------------------------
+// test_backtrace_emitted_on_error
+// ----------------------------------------------------------------------------
+TEST (Backtrace, test_backtrace_emitted_on_error) {
+  using Wrapper = cxxlog::transport::Backtrace<Collect>;
+
+  std::vector<cxxlog::Record> records {};
+  const cxxlog::Logger<Wrapper> logger { cxxlog::Severity::kWarn };
+  logger.transport (Wrapper { Collect { records }, 2 });
+
+  logger.debug ("step {}", 1);
+  logger.info ("step {}", 2, cxxlog::kv ("id", "x"));
+  logger.verbose ("step {}", 3);
+  logger.warn ("passed through");
+
+  ASSERT_EQ (records.size(), 1u);
+  EXPECT_EQ (records[0].message(), "passed through");
+
+  // the buffer only keeps the last two calls
+  logger.error ("failed");
+  ASSERT_EQ (records.size(), 4u);
+  EXPECT_EQ (records[1].message(), "step 2");
+  EXPECT_EQ (records[1].severity(), cxxlog::Severity::kInfo);
+  ASSERT_EQ (records[1].fields().size(), 1u);
+  EXPECT_EQ (std::get<std::string> (records[1].fields()[0].value), "x");
+  EXPECT_EQ (records[2].message(), "step 3");
+  EXPECT_EQ (records[3].message(), "failed");
+
+  // the buffer was emptied
+  logger.fatal ("again");
+  ASSERT_EQ (records.size(), 5u);
+  EXPECT_EQ (records[4].message(), "again");
+}
+
+// ----------------------------------------------------------------------------
+// test_backtrace_per_thread
+// ----------------------------------------------------------------------------
+TEST (Backtrace, test_backtrace_per_thread) {
+  using Wrapper = cxxlog::transport::Backtrace<Collect>;
+
+  std::vector<cxxlog::Record> records {};
+  const cxxlog::Logger<Wrapper> logger { cxxlog::Severity::kError };
+  logger.transport (Wrapper { Collect { records } });
+
+  logger.debug ("main thread");
+
+  std::thread { [ &logger ] () {
+    logger.debug ("other thread");
+    logger.error ("other failed");
+  } }.join();
+
+  ASSERT_EQ (records.size(), 2u);
+  EXPECT_EQ (records[0].message(), "other thread");
+  EXPECT_EQ (records[1].message(), "other failed");
+
+  logger.error ("main failed");
+  ASSERT_EQ (records.size(), 4u);
+  EXPECT_EQ (records[2].message(), "main thread");
+  EXPECT_EQ (records[3].message(), "main failed");
+}
+
+// ----------------------------------------------------------------------------
+// test_backtrace_thread_exit
+// ----------------------------------------------------------------------------
+TEST (Backtrace, test_backtrace_thread_exit) {
+  using Wrapper = cxxlog::transport::Backtrace<Collect>;
+
+  std::vector<cxxlog::Record> records {};
+  const Wrapper wrapper { Collect { records } };
+  const cxxlog::Logger<Wrapper> logger { cxxlog::Severity::kError };
+  logger.transport (wrapper);
+
+  logger.debug ("main thread");
+  EXPECT_EQ (wrapper.threads(), 1u);
+
+  // the buffers of the threads which exit are released
+  for (int i = 0; i < 8; ++i)
+    std::thread { [ &logger ] () { logger.debug ("short-lived thread"); } }.join();
+  EXPECT_EQ (wrapper.threads(), 1u);
+
+  logger.error ("main failed");
+  ASSERT_EQ (records.size(), 2u);
+  EXPECT_EQ (records[0].message(), "main thread");
+}
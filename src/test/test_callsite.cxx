@@ -0,0 +1,123 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/callsite.h>
+#include <cxxlog/transport.h>
+
+
+namespace {
+  void connect (const cxxlog::Logger<cxxlog::transport::OutputStream> &logger, int attempt) {
+    CXXLOG_DEBUG (logger, "connect attempt {}", attempt);
+  }
+
+  void query (const cxxlog::Logger<cxxlog::transport::OutputStream> &logger) {
+    CXXLOG_DEBUG (logger, "running query");
+    CXXLOG_LOG (logger, cxxlog::Severity::kWarn, "slow query");
+  }
+
+  void reconnect (const cxxlog::Logger<cxxlog::transport::OutputStream> &logger) {
+    CXXLOG_DEBUG (logger, "reconnecting");
+  }
+}
+
+// ----------------------------------------------------------------------------
+// test_callsite_glob
+// ----------------------------------------------------------------------------
+TEST (Callsite, test_callsite_glob) {
+  EXPECT_TRUE (cxxlog::detail::glob ("*.cxx", "test_callsite.cxx"));
+  EXPECT_TRUE (cxxlog::detail::glob ("test_?allsite*", "test_callsite.cxx"));
+  EXPECT_TRUE (cxxlog::detail::glob ("*", ""));
+  EXPECT_FALSE (cxxlog::detail::glob ("*.h", "test_callsite.cxx"));
+  EXPECT_FALSE (cxxlog::detail::glob ("test", "test_callsite.cxx"));
+}
+
+// ----------------------------------------------------------------------------
+// test_callsite_switch
+// ----------------------------------------------------------------------------
+TEST (Callsite, test_callsite_switch) {
+  std::stringstream ss {};
+  const cxxlog::Logger<cxxlog::transport::OutputStream> logger { cxxlog::Severity::kInfo };
+  logger.transport (cxxlog::transport::OutputStream { ss });
+
+  // the sites register on their first call
+  connect (logger, 1);
+  query (logger);
+  EXPECT_EQ (ss.str().find ("connect attempt 1"), std::string::npos);
+  EXPECT_EQ (ss.str().find ("running query"), std::string::npos);
+  EXPECT_NE (ss.str().find ("slow query"), std::string::npos);
+
+  EXPECT_EQ (cxxlog::Callsites::enable ("file=test_callsite.cxx func=connect"), 1u);
+  connect (logger, 2);
+  query (logger);
+  EXPECT_NE (ss.str().find ("connect attempt 2"), std::string::npos);
+  EXPECT_EQ (ss.str().find ("running query"), std::string::npos);
+
+  EXPECT_EQ (cxxlog::Callsites::enable ("format=query func=q*"), 2u);
+  query (logger);
+  EXPECT_NE (ss.str().find ("running query"), std::string::npos);
+
+  EXPECT_EQ (cxxlog::Callsites::disable ("file=*/test_callsite.cxx"), 3u);
+  connect (logger, 3);
+  EXPECT_EQ (ss.str().find ("connect attempt 3"), std::string::npos);
+
+  std::size_t sites { 0 };
+  cxxlog::Callsites::forEach ([ &sites ] (const cxxlog::Callsite &site) {
+    if (site.format() == "connect attempt {}") {
+      EXPECT_EQ (site.function(), "connect");
+      EXPECT_FALSE (site.enabled());
+    }
+    ++sites;
+  });
+  EXPECT_GE (sites, 3u);
+}
+
+// ----------------------------------------------------------------------------
+// test_callsite_query
+// ----------------------------------------------------------------------------
+TEST (Callsite, test_callsite_query) {
+  const cxxlog::Logger<cxxlog::transport::OutputStream> logger { cxxlog::Severity::kNone };
+  query (logger);
+
+  std::size_t line { 0 };
+  cxxlog::Callsites::forEach ([ &line ] (const cxxlog::Callsite &site) {
+    if (site.format() == "slow query")
+      line = site.line();
+  });
+  ASSERT_NE (line, 0u);
+
+  const auto range { std::to_string (line - 1) + "-" + std::to_string (line) };
+  EXPECT_EQ (cxxlog::Callsites::enable ("file=test_callsite.cxx line=" + range), 2u);
+  EXPECT_EQ (cxxlog::Callsites::disable ("file=test_callsite.cxx line=" + std::to_string (line)), 1u);
+  cxxlog::Callsites::disable ("file=test_callsite.cxx");
+
+  EXPECT_THROW (cxxlog::Callsites::enable ("file"), std::invalid_argument);
+  EXPECT_THROW (cxxlog::Callsites::enable ("module=x"), std::invalid_argument);
+  EXPECT_THROW (cxxlog::Callsites::enable ("line=1x"), std::invalid_argument);
+}
+
+// ----------------------------------------------------------------------------
+// test_callsite_later
+// ----------------------------------------------------------------------------
+TEST (Callsite, test_callsite_later) {
+  std::stringstream ss {};
+  const cxxlog::Logger<cxxlog::transport::OutputStream> logger { cxxlog::Severity::kInfo };
+  logger.transport (cxxlog::transport::OutputStream { ss });
+
+  // the statement hasn't run yet, so nothing matches, but the query is kept
+  EXPECT_EQ (cxxlog::Callsites::enable ("func=reconnect"), 0u);
+  reconnect (logger);
+  EXPECT_NE (ss.str().find ("reconnecting"), std::string::npos);
+
+  cxxlog::Callsites::reset();
+  ss.str ({});
+  reconnect (logger);
+  EXPECT_EQ (ss.str().find ("reconnecting"), std::string::npos);
+}
@@ -0,0 +1,155 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/config.h>
+#include <cxxlog/transport.h>
+
+
+namespace {
+  void write (const std::string &path, const std::string &text) {
+    std::ofstream { path } << text;
+  }
+
+  // Waits for the background thread to apply the file.
+  bool waitReloads (const cxxlog::ConfigWatcher &config, std::uint64_t reloads) {
+    for (int i = 0; i < 500 && config.reloads() < reloads; ++i)
+      std::this_thread::sleep_for (std::chrono::milliseconds { 10 });
+
+    return config.reloads() >= reloads;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// test_config_parse
+// ----------------------------------------------------------------------------
+TEST (ConfigWatcher, test_config_parse) {
+  EXPECT_EQ (cxxlog::detail::parseSeverity ("Debug"), cxxlog::Severity::kDebug);
+  EXPECT_EQ (cxxlog::detail::parseSeverity ("W"), cxxlog::Severity::kWarn);
+  EXPECT_EQ (cxxlog::detail::parseSeverity ("warning"), cxxlog::Severity::kWarn);
+  EXPECT_EQ (cxxlog::detail::parseSeverity ("off"), cxxlog::Severity::kNone);
+  EXPECT_THROW (cxxlog::detail::parseSeverity ("loud"), std::invalid_argument);
+
+  const auto path { (std::filesystem::temp_directory_path() / "cxxlog_test_config_parse.conf").string() };
+  write (path, "# comment\n level = debug # trailing\n\nlevel.net = error\nlevel.net.http=verbose\nunknown = 1\nfile.path = /tmp/x.log\n");
+
+  cxxlog::Logger<cxxlog::transport::OutputStream> logger {};
+  const cxxlog::Registry<cxxlog::transport::OutputStream> registry {};
+  std::string file {};
+
+  cxxlog::ConfigWatcher config { path };
+  config.level ("level", logger);
+  config.levels ("level.", registry);
+  config.on ("file.path", [ &file ] (std::string_view value) { file = value; });
+  config.reload();
+
+  EXPECT_EQ (config.reloads(), 1u);
+  EXPECT_EQ (logger.getLevel(), cxxlog::Severity::kDebug);
+  EXPECT_EQ (registry.getLevel (""), cxxlog::Severity::kDebug);
+  EXPECT_EQ (registry.getLevel ("net"), cxxlog::Severity::kError);
+  EXPECT_EQ (registry.getLevel ("net.http"), cxxlog::Severity::kVerbose);
+  EXPECT_EQ (file, "/tmp/x.log");
+
+  // a malformed file changes nothing
+  write (path, "level = error\nlevel.net = loud\n");
+  EXPECT_THROW (config.reload(), std::invalid_argument);
+  write (path, "level = error\nlevel.net\n");
+  EXPECT_THROW (config.reload(), std::invalid_argument);
+  EXPECT_EQ (logger.getLevel(), cxxlog::Severity::kDebug);
+  EXPECT_EQ (config.reloads(), 1u);
+
+  std::filesystem::remove (path);
+  EXPECT_THROW (config.reload(), std::system_error);
+}
+
+// ----------------------------------------------------------------------------
+// test_config_removed_keys
+// ----------------------------------------------------------------------------
+TEST (ConfigWatcher, test_config_removed_keys) {
+  const auto path { (std::filesystem::temp_directory_path() / "cxxlog_test_config_removed_keys.conf").string() };
+  write (path, "level = info\nlevel.net = debug\nlevel.net.http = error\nlevel.db = verbose\n");
+
+  const cxxlog::Registry<cxxlog::transport::OutputStream> registry {};
+
+  cxxlog::ConfigWatcher config { path };
+  config.levels ("level.", registry);
+  config.reload();
+  EXPECT_EQ (registry.getLevel ("net"), cxxlog::Severity::kDebug);
+  EXPECT_EQ (registry.getLevel ("net.http"), cxxlog::Severity::kError);
+  EXPECT_EQ (registry.getLevel ("db"), cxxlog::Severity::kVerbose);
+
+  // the removed keys fall back to the level of their parent
+  write (path, "level = warn\nlevel.net.http = error\n");
+  config.reload();
+  EXPECT_EQ (registry.getLevel ("net"), cxxlog::Severity::kWarn);
+  EXPECT_EQ (registry.getLevel ("net.http"), cxxlog::Severity::kError);
+  EXPECT_EQ (registry.getLevel ("db"), cxxlog::Severity::kWarn);
+
+  // the root keeps its level
+  write (path, "level.net.http = debug\n");
+  config.reload();
+  EXPECT_EQ (registry.getLevel (""), cxxlog::Severity::kWarn);
+  EXPECT_EQ (registry.getLevel ("net.http"), cxxlog::Severity::kDebug);
+
+  write (path, "");
+  config.reload();
+  EXPECT_EQ (registry.getLevel ("net.http"), cxxlog::Severity::kWarn);
+
+  std::filesystem::remove (path);
+}
+
+// ----------------------------------------------------------------------------
+// test_config_watch
+// ----------------------------------------------------------------------------
+TEST (ConfigWatcher, test_config_watch) {
+  const auto dir { std::filesystem::temp_directory_path() };
+  const auto path { (dir / "cxxlog_test_config_watch.conf").string() };
+  write (path, "level = warn\n");
+
+  cxxlog::Logger<cxxlog::transport::OutputStream> logger {};
+  std::atomic<int> errors { 0 };
+
+  cxxlog::ConfigWatcher config { path };
+  config.level ("level", logger);
+  config.onError ([ &errors ] (const std::exception &) { ++errors; });
+  config.start();
+  EXPECT_EQ (logger.getLevel(), cxxlog::Severity::kWarn);
+
+  // rewritten in place
+  write (path, "level = debug\n");
+  ASSERT_TRUE (waitReloads (config, 2));
+  EXPECT_EQ (logger.getLevel(), cxxlog::Severity::kDebug);
+
+  // replaced, as editors do
+  const auto next { (dir / "cxxlog_test_config_watch.conf.new").string() };
+  write (next, "level = error\n");
+  std::filesystem::rename (next, path);
+  ASSERT_TRUE (waitReloads (config, 3));
+  EXPECT_EQ (logger.getLevel(), cxxlog::Severity::kError);
+
+  // errors are reported and the level is kept
+  write (path, "level = loud\n");
+  for (int i = 0; i < 500 && errors == 0; ++i)
+    std::this_thread::sleep_for (std::chrono::milliseconds { 10 });
+  EXPECT_GT (errors.load(), 0);
+  EXPECT_EQ (logger.getLevel(), cxxlog::Severity::kError);
+
+  // other files of the directory are ignored
+  write (next, "level = verbose\n");
+  config.stop();
+  EXPECT_EQ (logger.getLevel(), cxxlog::Severity::kError);
+
+  std::filesystem::remove (path);
+  std::filesystem::remove (next);
+}
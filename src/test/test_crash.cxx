@@ -0,0 +1,113 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <atomic>
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/crash.h>
+#include <cxxlog/logger.h>
+#include <cxxlog/transport/async.h>
+#include <cxxlog/transport/flight_recorder.h>
+
+#include "test_helpers.h"
+
+
+namespace {
+  // Never returns, so the messages after the first one stay queued.
+  class Stuck {
+    public:
+      void log (const std::string &, cxxlog::Severity, std::chrono::milliseconds) const {
+        for (;;)
+          ::pause();
+      }
+  };
+}
+
+// ----------------------------------------------------------------------------
+// test_crash_raw_writer
+// ----------------------------------------------------------------------------
+TEST (CrashHandler, test_crash_raw_writer) {
+  const auto path { std::filesystem::temp_directory_path() / "cxxlog_test_crash_raw_writer.log" };
+  const auto fd { ::open (path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+  ASSERT_GE (fd, 0);
+
+  {
+    cxxlog::detail::RawWriter out { fd };
+    const std::vector<cxxlog::Field> fields { cxxlog::kv ("n", -42), cxxlog::kv ("u", 7u), cxxlog::kv ("r", 2.25), cxxlog::kv ("ok", false), cxxlog::kv ("s", "x y") };
+    out.line (cxxlog::Severity::kWarn, std::chrono::milliseconds { 987654321042 }, "message", fields);
+    out.line (cxxlog::Severity::kInfo, std::chrono::milliseconds { 951782400000 }, "leap day", {});
+    out.append (-0.5);
+    out.append (' ');
+    out.append (1e30);
+    out.append ('\n');
+  }
+
+  ::close (fd);
+
+  EXPECT_EQ (
+    readFile (path),
+    "2001-04-19T04:25:21 W: message n=-42 u=7 r=2.25 ok=false s=x y\n"
+    "2000-02-29T00:00:00 I: leap day\n"
+    "-0.5 inf\n"
+  );
+
+  std::filesystem::remove (path);
+}
+
+// ----------------------------------------------------------------------------
+// test_crash_handler_dumps_pending_messages
+// ----------------------------------------------------------------------------
+TEST (CrashHandler, test_crash_handler_dumps_pending_messages) {
+  GTEST_FLAG_SET (death_test_style, "threadsafe");
+
+  const auto path { std::filesystem::temp_directory_path() / "cxxlog_test_crash_handler.log" };
+  std::filesystem::remove (path);
+
+  const auto dies { [ &path ] () {
+    using Recorder = cxxlog::transport::FlightRecorder<Discard>;
+    using Queue = cxxlog::transport::Async<Stuck>;
+
+    const auto fd { ::open (path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+    cxxlog::CrashHandler crash { fd };
+
+    const Recorder recorder { Discard {} };
+    const Queue queue { Stuck {} };
+    crash.watch (recorder);
+    crash.watch (queue);
+
+    const cxxlog::Logger<Recorder, Queue> logger { cxxlog::Severity::kWarn };
+    logger.transport (Recorder { recorder });
+    logger.transport (Queue { queue });
+
+    logger.debug ("lazy {} {{{}}} {:>4}", 1.5, "text", 42, cxxlog::kv ("id", 7));
+    logger.warn ("first");
+    logger.error ("second {}", 2);
+
+    std::abort();
+  } };
+
+  EXPECT_EXIT (dies(), testing::KilledBySignal (SIGABRT), "");
+
+  const auto dump { readFile (path) };
+  EXPECT_NE (dump.find (" D: lazy 1.5 {text} 42 id=7\n"), std::string::npos);
+  EXPECT_NE (dump.find (" W: first\n"), std::string::npos);
+  EXPECT_NE (dump.find (" E: second 2\n"), std::string::npos);
+  EXPECT_NE (dump.find (" F: caught signal " + std::to_string (SIGABRT) + "\n"), std::string::npos);
+
+  // the queued message follows the ring
+  EXPECT_NE (dump.rfind (" E: second 2\n"), dump.find (" E: second 2\n"));
+
+  std::filesystem::remove (path);
+}
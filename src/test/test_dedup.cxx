@@ -0,0 +1,101 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/transport/dedup.h>
+
+#include "test_helpers.h"
+
+
+namespace {
+  using Wrapper = cxxlog::transport::Dedup<Collect>;
+}
+
+// ----------------------------------------------------------------------------
+// test_dedup_repeats
+// ----------------------------------------------------------------------------
+TEST (Dedup, test_dedup_repeats) {
+  std::vector<cxxlog::Record> records {};
+  const cxxlog::Logger<Wrapper> logger { cxxlog::Severity::kInfo };
+  logger.transport (Wrapper { Collect { records } });
+
+  for (int i = 0; i < 5; ++i)
+    logger.error ("connect failed: {}", "refused");
+
+  logger.error ("connect failed: {}", "timeout");
+  logger.info ("reconnected");
+  logger.info ("reconnected");
+
+  ASSERT_EQ (records.size(), 4u);
+  EXPECT_EQ (records[0].message(), "connect failed: refused");
+  EXPECT_EQ (records[1].message(), "last message repeated 4 times");
+  EXPECT_EQ (records[1].severity(), cxxlog::Severity::kError);
+  EXPECT_EQ (records[2].message(), "connect failed: timeout");
+  EXPECT_EQ (records[3].message(), "reconnected");
+
+  // the last repeat is summarized on flush
+  logger.flush();
+  ASSERT_EQ (records.size(), 5u);
+  EXPECT_EQ (records[4].message(), "last message repeated 1 time");
+  EXPECT_EQ (records[4].severity(), cxxlog::Severity::kInfo);
+
+  logger.flush();
+  EXPECT_EQ (records.size(), 5u);
+}
+
+// ----------------------------------------------------------------------------
+// test_dedup_differences
+// ----------------------------------------------------------------------------
+TEST (Dedup, test_dedup_differences) {
+  std::vector<cxxlog::Record> records {};
+  const cxxlog::Logger<Wrapper> logger { cxxlog::Severity::kInfo };
+  logger.transport (Wrapper { Collect { records } });
+
+  // same text, different severity or fields
+  logger.info ("done");
+  logger.warn ("done");
+  logger.warn ("done", cxxlog::kv ("code", 1));
+  logger.warn ("done", cxxlog::kv ("code", 2));
+  logger.warn ("done", cxxlog::kv ("code", 2));
+
+  ASSERT_EQ (records.size(), 4u);
+
+  logger.info ("other");
+  ASSERT_EQ (records.size(), 6u);
+  EXPECT_EQ (records[4].message(), "last message repeated 1 time");
+  EXPECT_EQ (records[5].message(), "other");
+}
+
+// ----------------------------------------------------------------------------
+// test_dedup_timeout
+// ----------------------------------------------------------------------------
+TEST (Dedup, test_dedup_timeout) {
+  std::vector<cxxlog::Record> records {};
+  const Wrapper dedup { Collect { records }, std::chrono::milliseconds { 1000 } };
+
+  dedup.log ("loop", cxxlog::Severity::kError, std::chrono::milliseconds { 10000 });
+  dedup.log ("loop", cxxlog::Severity::kError, std::chrono::milliseconds { 10100 });
+  dedup.log ("loop", cxxlog::Severity::kError, std::chrono::milliseconds { 10500 });
+  EXPECT_EQ (dedup.pending(), 2u);
+  EXPECT_EQ (records.size(), 1u);
+
+  // a second after the first repeat held back
+  dedup.log ("loop", cxxlog::Severity::kError, std::chrono::milliseconds { 11100 });
+  ASSERT_EQ (records.size(), 2u);
+  EXPECT_EQ (records[1].message(), "last message repeated 3 times");
+  EXPECT_EQ (records[1].timestamp(), std::chrono::milliseconds { 11100 });
+  EXPECT_EQ (dedup.pending(), 0u);
+
+  // the following repeats are held back again
+  dedup.log ("loop", cxxlog::Severity::kError, std::chrono::milliseconds { 11200 });
+  EXPECT_EQ (records.size(), 2u);
+  EXPECT_EQ (dedup.pending(), 1u);
+}
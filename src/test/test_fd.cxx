@@ -0,0 +1,260 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <cinttypes>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/transport/fd.h>
+
+#include "test_helpers.h"
+
+
+// ----------------------------------------------------------------------------
+// test_batched_line_limit
+// ----------------------------------------------------------------------------
+TEST (BatchedFile, test_batched_line_limit) {
+  const auto path { tempFile ("test_batched_line_limit.log") };
+  const std::chrono::milliseconds ts { 1234567890 };
+
+  cxxlog::transport::BatchedFile batchedFile { path, 4096, 3, std::chrono::hours { 1 } };
+
+  batchedFile.log ("line 1", cxxlog::Severity::kInfo, ts);
+  batchedFile.log ("line 2", cxxlog::Severity::kInfo, ts);
+  EXPECT_EQ (readFile (path), "");
+
+  batchedFile.log ("line 3", cxxlog::Severity::kInfo, ts);
+  EXPECT_EQ (readFile (path), "1970-01-15T06:56:07 I: line 1\n1970-01-15T06:56:07 I: line 2\n1970-01-15T06:56:07 I: line 3\n");
+}
+
+// ----------------------------------------------------------------------------
+// test_batched_byte_limit
+// ----------------------------------------------------------------------------
+TEST (BatchedFile, test_batched_byte_limit) {
+  const auto path { tempFile ("test_batched_byte_limit.log") };
+  const std::chrono::milliseconds ts { 1234567890 };
+
+  cxxlog::transport::BatchedFile batchedFile { path, 64, 100, std::chrono::hours { 1 } };
+
+  batchedFile.log ("0123456789", cxxlog::Severity::kWarn, ts);
+  EXPECT_EQ (readFile (path), "");
+
+  // doesn't fit in the batch: the pending line is written first
+  batchedFile.log ("0123456789abcdefghijklmnopqrstuvwxyz", cxxlog::Severity::kWarn, ts);
+  EXPECT_EQ (readFile (path), "1970-01-15T06:56:07 W: 0123456789\n");
+
+  // longer than a batch: written straight away
+  batchedFile.log (std::string (100, 'x'), cxxlog::Severity::kWarn, ts);
+  EXPECT_EQ (
+    readFile (path),
+    "1970-01-15T06:56:07 W: 0123456789\n"
+    "1970-01-15T06:56:07 W: 0123456789abcdefghijklmnopqrstuvwxyz\n"
+    "1970-01-15T06:56:07 W: " + std::string (100, 'x') + "\n"
+  );
+}
+
+// ----------------------------------------------------------------------------
+// test_batched_delay_limit
+// ----------------------------------------------------------------------------
+TEST (BatchedFile, test_batched_delay_limit) {
+  const auto path { tempFile ("test_batched_delay_limit.log") };
+  const std::chrono::milliseconds ts { 1234567890 };
+
+  cxxlog::transport::BatchedFile batchedFile { path, 4096, 100, std::chrono::milliseconds { 10 } };
+
+  batchedFile.log ("line 1", cxxlog::Severity::kDebug, ts);
+
+  // written by the background thread, without another line or a flush
+  std::this_thread::sleep_for (std::chrono::milliseconds { 20 });
+  for (int i = 0; i < 500 && readFile (path).empty(); ++i)
+    std::this_thread::sleep_for (std::chrono::milliseconds { 10 });
+  EXPECT_EQ (readFile (path), "1970-01-15T06:56:07 D: line 1\n");
+}
+
+// ----------------------------------------------------------------------------
+// test_batched_flush
+// ----------------------------------------------------------------------------
+TEST (BatchedFile, test_batched_flush) {
+  const auto path { tempFile ("test_batched_flush.log") };
+
+  const cxxlog::Logger<cxxlog::transport::BatchedFile> logger { cxxlog::Severity::kVerbose };
+  logger.transport (cxxlog::transport::BatchedFile { path });
+
+  logger.error ("Hello World!");
+  EXPECT_EQ (readFile (path), "");
+
+  logger.flush();
+  EXPECT_NE (readFile (path).find (" E: Hello World!\n"), std::string::npos);
+}
+
+// ----------------------------------------------------------------------------
+// test_batched_file_descriptor
+// ----------------------------------------------------------------------------
+TEST (BatchedFile, test_batched_file_descriptor) {
+  int fds[2];
+  ASSERT_EQ (::pipe (fds), 0);
+
+  {
+    cxxlog::transport::BatchedFile batchedFile { fds[1] };
+    batchedFile.log ("Test message", cxxlog::Severity::kFatal, std::chrono::milliseconds { 987654321000 });
+  }
+
+  char buf[128] {};
+  ASSERT_GT (::read (fds[0], buf, sizeof (buf)), 0);
+  EXPECT_STREQ (buf, "2001-04-19T04:25:21 F: Test message\n");
+
+  ::close (fds[0]);
+  ::close (fds[1]);
+}
+
+// ----------------------------------------------------------------------------
+// test_batched_shared_file
+// ----------------------------------------------------------------------------
+TEST (BatchedFile, test_batched_shared_file) {
+  const auto path { tempFile ("test_batched_shared_file.log") };
+  constexpr int kWriters { 4 };
+  constexpr int kLines { 2000 };
+
+  // independent transports on the same file behave like separate processes
+  std::vector<std::thread> threads {};
+  for (int w = 0; w < kWriters; ++w) {
+    threads.emplace_back ([ &path, w ] () {
+      cxxlog::transport::BatchedFile batchedFile { path, 1024, 16 };
+      for (int i = 0; i < kLines; ++i)
+        batchedFile.log (cxxlog::fmtlib::format ("writer {} line {}", w, i), cxxlog::Severity::kInfo, std::chrono::milliseconds { 0 });
+    });
+  }
+
+  for (auto &thread: threads)
+    thread.join();
+
+  std::vector<int> next (kWriters, 0);
+  std::istringstream lines { readFile (path) };
+  for (std::string line; std::getline (lines, line);) {
+    int w { 0 };
+    int i { 0 };
+    ASSERT_EQ (std::sscanf (line.c_str(), "1970-01-01T00:00:00 I: writer %d line %d", &w, &i), 2) << line;
+    ASSERT_EQ (i, next[w]++);
+  }
+
+  for (const auto n: next)
+    EXPECT_EQ (n, kLines);
+}
+
+// ----------------------------------------------------------------------------
+// test_append_message_with_severity
+// ----------------------------------------------------------------------------
+TEST (AppendFile, test_append_message_with_severity) {
+  const auto path { tempFile ("test_append_message_with_severity.log") };
+
+  std::ofstream { path } << "previous line\n";
+
+  cxxlog::transport::AppendFile appendFile { path };
+  appendFile.log ("Test message", cxxlog::Severity::kInfo, std::chrono::milliseconds { 1234567890 });
+  appendFile.log ("", cxxlog::Severity::kDebug, std::chrono::milliseconds { 1234567890 });
+
+  EXPECT_EQ (readFile (path), "previous line\n1970-01-15T06:56:07 I: Test message\n1970-01-15T06:56:07 D: \n");
+}
+
+// ----------------------------------------------------------------------------
+// test_append_split_record
+// ----------------------------------------------------------------------------
+TEST (AppendFile, test_append_split_record) {
+  const auto path { tempFile ("test_append_split_record.log") };
+
+  std::string msg {};
+  for (int i = 0; i < 100; ++i)
+    msg += cxxlog::fmtlib::format ("{:04} ", i);
+
+  cxxlog::transport::AppendFile appendFile { path, 200 };
+  appendFile.log (msg, cxxlog::Severity::kError, std::chrono::milliseconds { 987654321000 });
+
+  std::string joined {};
+  std::size_t parts { 0 };
+  std::istringstream lines { readFile (path) };
+  for (std::string line; std::getline (lines, line); ++parts) {
+    ASSERT_LE (line.size() + 1, appendFile.atomicSize());
+    ASSERT_EQ (line.rfind ("2001-04-19T04:25:21 E: [", 0), 0u) << line;
+
+    const auto marker { line.find ("] ") };
+    ASSERT_NE (marker, std::string::npos);
+    ASSERT_NE (line.find (cxxlog::fmtlib::format (".0 {}/", parts + 1)), std::string::npos) << line;
+    joined += line.substr (marker + 2);
+  }
+
+  EXPECT_GT (parts, 1u);
+  EXPECT_EQ (joined, msg);
+}
+
+// ----------------------------------------------------------------------------
+// test_append_multiple_processes
+// ----------------------------------------------------------------------------
+TEST (AppendFile, test_append_multiple_processes) {
+  const auto path { tempFile ("test_append_multiple_processes.log") };
+  constexpr int kProcesses { 4 };
+  constexpr int kLines { 1000 };
+
+  std::vector<pid_t> children {};
+  for (int p = 0; p < kProcesses; ++p) {
+    const auto pid { ::fork() };
+    ASSERT_GE (pid, 0);
+
+    if (pid == 0) {
+      cxxlog::transport::AppendFile appendFile { path, 256 };
+      for (int i = 0; i < kLines; ++i) {
+        // every tenth record is split in several lines
+        const std::string padding (i % 10 == 0 ? 400 : 10, static_cast<char> ('a' + p));
+        appendFile.log (cxxlog::fmtlib::format ("process {} line {} {}", p, i, padding), cxxlog::Severity::kInfo, std::chrono::milliseconds { 0 });
+      }
+      ::_exit (0);
+    }
+
+    children.push_back (pid);
+  }
+
+  for (const auto pid: children) {
+    int status { 0 };
+    ASSERT_EQ (::waitpid (pid, &status, 0), pid);
+    ASSERT_TRUE (WIFEXITED (status) && WEXITSTATUS (status) == 0);
+  }
+
+  std::map<std::string, std::string> split {};
+  std::vector<int> next (kProcesses, 0);
+  std::istringstream lines { readFile (path) };
+  for (std::string line; std::getline (lines, line);) {
+    ASSERT_EQ (line.rfind ("1970-01-01T00:00:00 I: ", 0), 0u) << line;
+    auto text { line.substr (23) };
+
+    if (text[0] == '[') {
+      const auto marker { text.find ("] ") };
+      const auto slash { text.find ('/') };
+      const auto id { text.substr (1, text.find (' ') - 1) };
+      split[id] += text.substr (marker + 2);
+      if (text.substr (text.find (' ') + 1, slash - text.find (' ') - 1) != text.substr (slash + 1, marker - slash - 1))
+        continue;
+
+      text = split[id];
+    }
+
+    int p { 0 };
+    int i { 0 };
+    ASSERT_EQ (std::sscanf (text.c_str(), "process %d line %d", &p, &i), 2) << text;
+    ASSERT_EQ (i, next[p]++);
+    ASSERT_EQ (text.substr (text.rfind (' ') + 1), std::string (i % 10 == 0 ? 400 : 10, static_cast<char> ('a' + p)));
+  }
+
+  for (const auto n: next)
+    EXPECT_EQ (n, kLines);
+}
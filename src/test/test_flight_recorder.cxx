@@ -0,0 +1,105 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <cinttypes>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/transport/flight_recorder.h>
+
+#include "test_helpers.h"
+
+
+// ----------------------------------------------------------------------------
+// test_flight_recorder_dump_on_fatal
+// ----------------------------------------------------------------------------
+TEST (FlightRecorder, test_flight_recorder_dump_on_fatal) {
+  using Recorder = cxxlog::transport::FlightRecorder<Collect>;
+
+  std::vector<cxxlog::Record> records {};
+  const cxxlog::Logger<Recorder> logger { cxxlog::Severity::kError };
+  const Recorder recorder { Collect { records } };
+  logger.transport (Recorder { recorder });
+
+  logger.debug ("value {} of {}", 42, std::string { "answer" }, cxxlog::kv ("ratio", 0.5));
+  logger.verbose ("pointer {}", static_cast<const void *> (nullptr));
+  logger.info ("text {}", "literal");
+  EXPECT_TRUE (records.empty());
+
+  logger.fatal ("boom");
+
+  ASSERT_EQ (records.size(), 4u);
+  EXPECT_EQ (records[0].message(), "value 42 of answer");
+  EXPECT_EQ (records[0].severity(), cxxlog::Severity::kDebug);
+  ASSERT_EQ (records[0].fields().size(), 1u);
+  EXPECT_EQ (records[0].fields()[0].key, "ratio");
+  EXPECT_EQ (std::get<double> (records[0].fields()[0].value), 0.5);
+  EXPECT_EQ (records[0].thread(), records[3].thread());
+  EXPECT_EQ (records[1].message(), "pointer 0x0");
+  EXPECT_EQ (records[2].message(), "text literal");
+  EXPECT_EQ (records[3].message(), "boom");
+  EXPECT_EQ (records[3].severity(), cxxlog::Severity::kFatal);
+
+  // already dumped calls are not dumped again
+  logger.warn ("after");
+  recorder.dump();
+  ASSERT_EQ (records.size(), 5u);
+  EXPECT_EQ (records[4].message(), "after");
+}
+
+// ----------------------------------------------------------------------------
+// test_flight_recorder_wraps_around
+// ----------------------------------------------------------------------------
+TEST (FlightRecorder, test_flight_recorder_wraps_around) {
+  std::vector<cxxlog::Record> records {};
+  const cxxlog::transport::FlightRecorder<Collect> recorder { Collect { records }, 4, 64 };
+  EXPECT_EQ (recorder.capacity(), 4u);
+
+  for (int i = 0; i < 10; ++i)
+    recorder.capture (cxxlog::Severity::kInfo, std::chrono::milliseconds { i }, "n={}", i);
+
+  // truncated to fit in the slot
+  recorder.log (cxxlog::Record { std::string (200, 'x'), cxxlog::Severity::kWarn, std::chrono::milliseconds { 10 } });
+
+  recorder.dump();
+  ASSERT_EQ (records.size(), 4u);
+  EXPECT_EQ (records[0].message(), "n=7");
+  EXPECT_EQ (records[0].timestamp(), std::chrono::milliseconds { 7 });
+  EXPECT_EQ (records[2].message(), "n=9");
+  EXPECT_LT (records[3].message().size(), 64u);
+  EXPECT_EQ (records[3].message().find_first_not_of ('x'), std::string::npos);
+}
+
+// ----------------------------------------------------------------------------
+// test_flight_recorder_threads
+// ----------------------------------------------------------------------------
+TEST (FlightRecorder, test_flight_recorder_threads) {
+  std::vector<cxxlog::Record> records {};
+  const cxxlog::transport::FlightRecorder<Collect> recorder { Collect { records }, 64 };
+
+  std::vector<std::thread> threads {};
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back ([ &recorder, t ] () {
+      for (int i = 0; i < 1000; ++i)
+        recorder.capture (cxxlog::Severity::kDebug, std::chrono::milliseconds { i }, "{} {}", t, i);
+    });
+  }
+
+  // dumps racing with the writers only deliver complete calls
+  for (int i = 0; i < 20; ++i)
+    recorder.dump();
+
+  for (auto &thread: threads)
+    thread.join();
+
+  recorder.dump();
+  EXPECT_LE (records.size(), 4000u);
+  for (const auto &record: records)
+    EXPECT_TRUE (record.message().find (' ') + 1 < record.message().size());
+}
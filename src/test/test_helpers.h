@@ -0,0 +1,70 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#ifndef __CXX_LOGGER_TEST_HELPERS_H__
+#define __CXX_LOGGER_TEST_HELPERS_H__
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <cxxlog/logger.h>
+
+
+// ----------------------------------------------------------------------------
+// Helpers of the file transport tests
+// ----------------------------------------------------------------------------
+
+// Gets the path of a file in the temporary directory, removing any previous file.
+inline std::filesystem::path tempFile (const char *name) {
+  const auto path { std::filesystem::temp_directory_path() / name };
+  std::filesystem::remove (path);
+
+  return path;
+}
+
+// Reads a whole file.
+inline std::string readFile (const std::filesystem::path &path) {
+  std::ifstream in { path, std::ios::in | std::ios::binary };
+
+  return std::string ((std::istreambuf_iterator<char> { in }), std::istreambuf_iterator<char> {});
+}
+
+
+// ----------------------------------------------------------------------------
+// Transports of the logger and wrapper tests
+// ----------------------------------------------------------------------------
+
+// Appends every record to a vector. Copies share the vector, which is guarded by a mutex.
+class Collect {
+  public:
+    Collect (std::vector<cxxlog::Record> &records): _records { records } {
+      // empty
+    }
+
+    void log (const cxxlog::Record &record) const {
+      const std::lock_guard lock { _mutex };
+      _records.get().push_back (record);
+    }
+
+  private:
+    std::reference_wrapper<std::vector<cxxlog::Record>> _records;
+    inline static std::mutex _mutex {};
+};
+
+// Drops every message.
+class Discard {
+  public:
+    void log (const std::string &, cxxlog::Severity, std::chrono::milliseconds) const {
+      // empty
+    }
+};
+
+#endif
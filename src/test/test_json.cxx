@@ -0,0 +1,92 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <cinttypes>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/transport/json.h>
+
+
+// ----------------------------------------------------------------------------
+// test_json_message_with_severity
+// ----------------------------------------------------------------------------
+TEST (JsonStream, test_json_message_with_severity) {
+  std::stringstream ss {};
+  cxxlog::transport::JsonStream jsonStream { ss };
+
+  jsonStream.log ("Test message", cxxlog::Severity::kInfo, std::chrono::milliseconds { 987654321042 });
+  jsonStream.log ("", cxxlog::Severity::kFatal, std::chrono::milliseconds { 1234567890 });
+
+  EXPECT_EQ (
+    ss.str(),
+    "{\"ts\":\"2001-04-19T04:25:21.042Z\",\"sev\":\"I\",\"msg\":\"Test message\"}\n"
+    "{\"ts\":\"1970-01-15T06:56:07.890Z\",\"sev\":\"F\",\"msg\":\"\"}\n"
+  );
+}
+
+// ----------------------------------------------------------------------------
+// test_json_structured_fields
+// ----------------------------------------------------------------------------
+TEST (JsonStream, test_json_structured_fields) {
+  std::stringstream ss {};
+
+  const cxxlog::Logger<cxxlog::transport::JsonStream> logger { cxxlog::Severity::kVerbose };
+  logger.transport (cxxlog::transport::JsonStream { ss });
+
+  logger.warn (
+    "req {} done", 7,
+    cxxlog::kv ("status", 200), cxxlog::kv ("ms", 3.5), cxxlog::kv ("ok", false), cxxlog::kv ("path", "/a\"b"),
+    cxxlog::kv ("nan", std::numeric_limits<double>::quiet_NaN()), cxxlog::kv ("big", std::numeric_limits<std::uint64_t>::max())
+  );
+
+  const std::string_view head { "\"sev\":\"W\",\"msg\":\"req 7 done\"," };
+  const auto line { ss.str() };
+  const auto msg { line.find (head) };
+  ASSERT_NE (msg, std::string::npos) << line;
+  EXPECT_EQ (
+    line.substr (msg + head.size()),
+    "\"status\":200,\"ms\":3.5,\"ok\":false,\"path\":\"/a\\\"b\",\"nan\":null,\"big\":18446744073709551615}\n"
+  );
+}
+
+// ----------------------------------------------------------------------------
+// test_json_escaping
+// ----------------------------------------------------------------------------
+TEST (JsonStream, test_json_escaping) {
+  constexpr char kInput[] { "a\"b\\c\nd\te\x01\x1f\x7f \xc3\xa9" };
+
+  std::string out {};
+  cxxlog::transport::detail::escapeJson (out, std::string_view { kInput, sizeof (kInput) - 1 });
+
+  EXPECT_EQ (out, "a\\\"b\\\\c\\nd\\te\\u0001\\u001f\x7f \xc3\xa9");
+}
+
+// ----------------------------------------------------------------------------
+// test_json_escaping_blocks
+// ----------------------------------------------------------------------------
+TEST (JsonStream, test_json_escaping_blocks) {
+  // special characters at every position of (and across) the vector blocks, and every byte value
+  std::string input {};
+  for (int i = 0; i < 256; ++i) {
+    input += std::string (static_cast<std::size_t> (i % 37), 'x');
+    input += static_cast<char> (i);
+  }
+
+  for (std::size_t offset = 0; offset < 64; ++offset) {
+    const std::string_view s { input.data() + offset, input.size() - offset };
+
+    std::string simd {};
+    std::string scalar {};
+    cxxlog::transport::detail::escapeJson (simd, s);
+    cxxlog::transport::detail::escapeJsonScalar (scalar, s);
+
+    ASSERT_EQ (simd, scalar) << offset;
+  }
+}
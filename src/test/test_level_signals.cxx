@@ -0,0 +1,88 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <chrono>
+#include <csignal>
+#include <stdexcept>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/level_signals.h>
+#include <cxxlog/transport.h>
+
+
+// ----------------------------------------------------------------------------
+// test_level_signals_step
+// ----------------------------------------------------------------------------
+TEST (LevelSignals, test_level_signals_step) {
+  using cxxlog::LevelSignals;
+  using cxxlog::Severity;
+
+  EXPECT_EQ (LevelSignals::step (Severity::kInfo, -1), Severity::kDebug);
+  EXPECT_EQ (LevelSignals::step (Severity::kInfo, 2), Severity::kError);
+  EXPECT_EQ (LevelSignals::step (Severity::kVerbose, -1), Severity::kVerbose);
+  EXPECT_EQ (LevelSignals::step (Severity::kFatal, 1), Severity::kNone);
+  EXPECT_EQ (LevelSignals::step (Severity::kNone, 5), Severity::kNone);
+  EXPECT_EQ (LevelSignals::step (Severity::kNone, -1), Severity::kFatal);
+}
+
+// ----------------------------------------------------------------------------
+// test_level_signals_apply
+// ----------------------------------------------------------------------------
+TEST (LevelSignals, test_level_signals_apply) {
+  cxxlog::Logger<cxxlog::transport::OutputStream> first { cxxlog::Severity::kInfo };
+  cxxlog::Logger<cxxlog::transport::OutputStream> second { cxxlog::Severity::kWarn };
+
+  cxxlog::LevelSignals signals { SIGUSR1, SIGUSR2, false };
+  signals.watch (first);
+  signals.watch (second);
+
+  EXPECT_THROW (cxxlog::LevelSignals {}, std::logic_error);
+
+  // the handler only queues the steps
+  std::raise (SIGUSR1);
+  std::raise (SIGUSR1);
+  EXPECT_EQ (first.getLevel(), cxxlog::Severity::kInfo);
+
+  EXPECT_EQ (signals.apply(), -2);
+  EXPECT_EQ (first.getLevel(), cxxlog::Severity::kVerbose);
+  EXPECT_EQ (second.getLevel(), cxxlog::Severity::kDebug);
+
+  std::raise (SIGUSR2);
+  EXPECT_EQ (signals.apply(), 1);
+  EXPECT_EQ (signals.apply(), 0);
+  EXPECT_EQ (first.getLevel(), cxxlog::Severity::kDebug);
+  EXPECT_EQ (second.getLevel(), cxxlog::Severity::kInfo);
+
+  // the steps are clamped one by one, in order
+  for (int i = 0; i < 10; ++i)
+    std::raise (SIGUSR2);
+  std::raise (SIGUSR1);
+  EXPECT_EQ (signals.apply(), 9);
+  EXPECT_EQ (first.getLevel(), cxxlog::Severity::kFatal);
+  EXPECT_EQ (second.getLevel(), cxxlog::Severity::kFatal);
+}
+
+// ----------------------------------------------------------------------------
+// test_level_signals_thread
+// ----------------------------------------------------------------------------
+TEST (LevelSignals, test_level_signals_thread) {
+  cxxlog::Logger<cxxlog::transport::OutputStream> logger { cxxlog::Severity::kInfo };
+
+  {
+    cxxlog::LevelSignals signals {};
+    signals.watch (logger);
+
+    std::raise (SIGUSR2);
+    for (int i = 0; i < 500 && logger.getLevel() == cxxlog::Severity::kInfo; ++i)
+      std::this_thread::sleep_for (std::chrono::milliseconds { 10 });
+
+    EXPECT_EQ (logger.getLevel(), cxxlog::Severity::kWarn);
+  }
+
+  // a new object can be installed once the previous one is gone
+  cxxlog::LevelSignals signals {};
+}
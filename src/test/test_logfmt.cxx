@@ -0,0 +1,67 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <cinttypes>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/transport/logfmt.h>
+
+
+// ----------------------------------------------------------------------------
+// test_logfmt_message_with_severity
+// ----------------------------------------------------------------------------
+TEST (LogfmtStream, test_logfmt_message_with_severity) {
+  std::stringstream ss {};
+  cxxlog::transport::LogfmtStream logfmtStream { ss };
+
+  logfmtStream.log ("Test message", cxxlog::Severity::kInfo, std::chrono::milliseconds { 987654321042 });
+  logfmtStream.log ("single", cxxlog::Severity::kVerbose, std::chrono::milliseconds { 1234567890 });
+  logfmtStream.log ("", cxxlog::Severity::kError, std::chrono::milliseconds { 1234567890 });
+
+  EXPECT_EQ (
+    ss.str(),
+    "ts=2001-04-19T04:25:21.042Z level=info msg=\"Test message\"\n"
+    "ts=1970-01-15T06:56:07.890Z level=trace msg=single\n"
+    "ts=1970-01-15T06:56:07.890Z level=error msg=\"\"\n"
+  );
+}
+
+// ----------------------------------------------------------------------------
+// test_logfmt_quoting
+// ----------------------------------------------------------------------------
+TEST (LogfmtStream, test_logfmt_quoting) {
+  const auto encode { [] (std::string_view s) {
+    std::string out {};
+    cxxlog::detail::appendQuotedString (out, s);
+    return out;
+  } };
+
+  EXPECT_EQ (encode ("plain"), "plain");
+  EXPECT_EQ (encode ("back\\slash"), "back\\slash");
+  EXPECT_EQ (encode ("a=b"), "\"a=b\"");
+  EXPECT_EQ (encode ("say \"hi\""), "\"say \\\"hi\\\"\"");
+  EXPECT_EQ (encode ("line\nbreak\\"), "\"line\\nbreak\\\\\"");
+  EXPECT_EQ (encode (std::string_view { "\x01\t", 2 }), "\"\\u0001\\t\"");
+  EXPECT_EQ (encode ("\xc3\xa9t\xc3\xa9"), "\xc3\xa9t\xc3\xa9");
+}
+
+// ----------------------------------------------------------------------------
+// test_logfmt_structured_fields
+// ----------------------------------------------------------------------------
+TEST (LogfmtStream, test_logfmt_structured_fields) {
+  std::stringstream ss {};
+
+  const cxxlog::Logger<cxxlog::transport::LogfmtStream> logger { cxxlog::Severity::kVerbose };
+  logger.transport (cxxlog::transport::LogfmtStream { ss });
+
+  logger.warn ("req {} done", 7, cxxlog::kv ("status", 200), cxxlog::kv ("ms", 3.5), cxxlog::kv ("ok", true), cxxlog::kv ("user name", "a b"));
+
+  const auto line { ss.str() };
+  EXPECT_EQ (line.substr (28), "level=warn msg=\"req 7 done\" status=200 ms=3.5 ok=true user_name=\"a b\"\n");
+}
@@ -8,6 +8,9 @@
 #include <fstream>
 #include <sstream>
 #include <streambuf>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -297,3 +300,199 @@ TEST (Logger, test_same_transport_multiple_times) {
 
   ASSERT_NE (str.find (" F: Hello World!\n"), std::string::npos);
 }
+
+// ----------------------------------------------------------------------------
+// test_shared_record
+// ----------------------------------------------------------------------------
+namespace {
+  // Keeps every record it receives.
+  class RecordTransport {
+    public:
+      using layout_type = cxxlog::DefaultLayout;
+
+      RecordTransport (std::vector<cxxlog::Record> &records): _records { records } {
+        // empty
+      }
+
+      void log (const cxxlog::Record &record) const {
+        _records.get().push_back (record);
+      }
+
+    private:
+      std::reference_wrapper<std::vector<cxxlog::Record>> _records;
+  };
+}
+
+TEST (Logger, test_shared_record) {
+  const cxxlog::Logger<RecordTransport, cxxlog::transport::OutputStream> logger { cxxlog::Severity::kVerbose };
+
+  std::vector<cxxlog::Record> records {};
+  std::stringstream ss {};
+  logger.transport (RecordTransport { records });
+  logger.transport (RecordTransport { records });
+  logger.transport (cxxlog::transport::OutputStream { ss });
+
+  logger.warn ("hello {}", "record");
+
+  // both transports got the same immutable record, with the default layout rendered once
+  ASSERT_EQ (records.size(), 2u);
+  EXPECT_EQ (&records[0].message(), &records[1].message());
+  EXPECT_EQ (records[0].message(), "hello record");
+  EXPECT_EQ (records[0].severity(), cxxlog::Severity::kWarn);
+  EXPECT_TRUE (records[0].rendered<cxxlog::DefaultLayout>());
+
+  std::string scratch {};
+  const auto parts0 { records[0].parts<cxxlog::DefaultLayout> (scratch) };
+  const auto parts1 { records[1].parts<cxxlog::DefaultLayout> (scratch) };
+  EXPECT_EQ (parts0.prefix.data(), parts1.prefix.data());
+  EXPECT_TRUE (scratch.empty());
+
+  // the output stream writes the same prefix and suffix
+  EXPECT_EQ (ss.str(), std::string { parts0.prefix } + "hello record" + std::string { parts0.suffix });
+  EXPECT_EQ (parts0.prefix.substr (parts0.prefix.size() - 3), "W: ");
+  EXPECT_EQ (parts0.suffix, "\n");
+}
+
+// ----------------------------------------------------------------------------
+// test_record_layout_fallback
+// ----------------------------------------------------------------------------
+TEST (Logger, test_record_layout_fallback) {
+  struct BracketLayout {
+    static void prefix (std::string &out, const cxxlog::Record &r) { out += cxxlog::fmtlib::format ("[{}] ", cxxlog::Logger<>::toCString (r.severity())); }
+    static void suffix (std::string &out, const cxxlog::Record &) { out += ";"; }
+  };
+
+  static_assert (cxxlog::Layout<BracketLayout>);
+
+  const auto record { cxxlog::Record::make<cxxlog::DefaultLayout, void, cxxlog::DefaultLayout> ("msg", cxxlog::Severity::kError, std::chrono::milliseconds { 1234567890 }) };
+  EXPECT_TRUE (record.rendered<cxxlog::DefaultLayout>());
+  EXPECT_FALSE (record.rendered<BracketLayout>());
+
+  // layouts which weren't rendered in advance are rendered into the scratch buffer
+  std::string scratch {};
+  const auto parts { record.parts<BracketLayout> (scratch) };
+  EXPECT_EQ (parts.prefix, "[E] ");
+  EXPECT_EQ (parts.suffix, ";");
+
+  const auto defaults { record.parts<cxxlog::DefaultLayout> (scratch) };
+  EXPECT_EQ (defaults.prefix, "1970-01-15T06:56:07 E: ");
+}
+
+// ----------------------------------------------------------------------------
+// test_record_view
+// ----------------------------------------------------------------------------
+TEST (Logger, test_record_view) {
+  const std::string msg (200, 'x');
+  const cxxlog::Record::View view { msg, cxxlog::Severity::kInfo, std::chrono::milliseconds { 1234567890 } };
+  const cxxlog::Record &record { view };
+
+  // the view borrows the message instead of copying it
+  EXPECT_EQ (&record.message(), &msg);
+  EXPECT_EQ (record.severity(), cxxlog::Severity::kInfo);
+  EXPECT_TRUE (record.fields().empty());
+  EXPECT_FALSE (record.rendered<cxxlog::DefaultLayout>());
+
+  std::string scratch {};
+  EXPECT_EQ (record.parts<cxxlog::DefaultLayout> (scratch).prefix, "1970-01-15T06:56:07 I: ");
+}
+
+// ----------------------------------------------------------------------------
+// test_structured_fields
+// ----------------------------------------------------------------------------
+TEST (Logger, test_structured_fields) {
+  const cxxlog::Logger<RecordTransport, cxxlog::transport::OutputStream> logger { cxxlog::Severity::kVerbose };
+
+  std::vector<cxxlog::Record> records {};
+  std::stringstream ss {};
+  logger.transport (RecordTransport { records });
+  logger.transport (cxxlog::transport::OutputStream { ss });
+
+  const std::string path { "/index html" };
+  logger.info ("req {} done", 42, cxxlog::kv ("status", 200), cxxlog::kv ("ms", 3.25), cxxlog::kv ("path", path), cxxlog::kv ("ok", true), cxxlog::kv ("bytes", 10u));
+
+  ASSERT_EQ (records.size(), 1u);
+  EXPECT_EQ (records[0].message(), "req 42 done");
+
+  // the fields keep their types
+  const auto fields { records[0].fields() };
+  ASSERT_EQ (fields.size(), 5u);
+  EXPECT_EQ (fields[0].key, "status");
+  EXPECT_EQ (std::get<std::int64_t> (fields[0].value), 200);
+  EXPECT_EQ (std::get<double> (fields[1].value), 3.25);
+  EXPECT_EQ (std::get<std::string> (fields[2].value), path);
+  EXPECT_EQ (std::get<bool> (fields[3].value), true);
+  EXPECT_EQ (std::get<std::uint64_t> (fields[4].value), 10u);
+
+  // text layouts write them after the message
+  EXPECT_EQ (ss.str().substr (20), "I: req 42 done status=200 ms=3.25 path=\"/index html\" ok=true bytes=10\n");
+
+  // fields without format arguments
+  records.clear();
+  logger.warn ("no arguments", cxxlog::kv ("key", "value"));
+  ASSERT_EQ (records.size(), 1u);
+  EXPECT_EQ (records[0].message(), "no arguments");
+  ASSERT_EQ (records[0].fields().size(), 1u);
+  EXPECT_EQ (std::get<std::string> (records[0].fields()[0].value), "value");
+}
+
+// ----------------------------------------------------------------------------
+// test_sampling
+// ----------------------------------------------------------------------------
+TEST (Logger, test_sampling) {
+  cxxlog::Logger<RecordTransport> logger { cxxlog::Severity::kVerbose };
+
+  std::vector<cxxlog::Record> records {};
+  logger.transport (RecordTransport { records });
+
+  EXPECT_EQ (logger.getSampleRate (cxxlog::Severity::kInfo), 1.0);
+  logger.setSampleRate (cxxlog::Severity::kInfo, 0.01);
+  EXPECT_NEAR (logger.getSampleRate (cxxlog::Severity::kInfo), 0.01, 1e-12);
+
+  for (int i = 0; i < 100000; ++i)
+    logger.info ("sampled {}", i, cxxlog::kv ("n", i));
+
+  // about 1%: 1000 +/- 6 standard deviations, so the test fails about once in 10^9 runs
+  EXPECT_GT (records.size(), 800u);
+  EXPECT_LT (records.size(), 1200u);
+
+  // the kept records carry the rate after their own fields
+  const auto fields { records.front().fields() };
+  ASSERT_EQ (fields.size(), 2u);
+  EXPECT_EQ (fields[1].key, cxxlog::Logger<>::kSampleRateField);
+  EXPECT_NEAR (std::get<double> (fields[1].value), 0.01, 1e-12);
+
+  // the other levels are not sampled
+  records.clear();
+  logger.warn ("kept");
+  ASSERT_EQ (records.size(), 1u);
+  EXPECT_TRUE (records[0].fields().empty());
+
+  // a copy keeps the rates
+  auto copy { logger };
+  EXPECT_NEAR (copy.getSampleRate (cxxlog::Severity::kInfo), 0.01, 1e-12);
+
+  // and so does a move, which takes the transports
+  static_assert (std::is_nothrow_move_constructible_v<cxxlog::Logger<RecordTransport>>);
+  const auto moved { std::move (copy) };
+  EXPECT_NEAR (moved.getSampleRate (cxxlog::Severity::kInfo), 0.01, 1e-12);
+  EXPECT_EQ (moved.getLevel(), cxxlog::Severity::kVerbose);
+  records.clear();
+  moved.warn ("moved");
+  EXPECT_EQ (records.size(), 1u);
+
+  records.clear();
+  logger.setSampleRate (cxxlog::Severity::kInfo, 0.0);
+  for (int i = 0; i < 1000; ++i)
+    logger.info ("dropped");
+  EXPECT_TRUE (records.empty());
+
+  logger.setSampleRate (cxxlog::Severity::kInfo, 1.0);
+  logger.info ("kept");
+  ASSERT_EQ (records.size(), 1u);
+  EXPECT_TRUE (records[0].fields().empty());
+  EXPECT_EQ (logger.getSampleRate (cxxlog::Severity::kInfo), 1.0);
+
+  // kNone has no sample rate
+  logger.setSampleRate (cxxlog::Severity::kNone, 0.0);
+  EXPECT_EQ (logger.getSampleRate (cxxlog::Severity::kNone), 1.0);
+}
@@ -0,0 +1,210 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <cinttypes>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/transport.h>
+#include <cxxlog/transport/async.h>
+
+#include "test_helpers.h"
+
+
+namespace {
+  // Holds a token, to tell when the last copy of the transport is gone.
+  class Token {
+    public:
+      Token (std::shared_ptr<int> token): _token { std::move (token) } {
+        // empty
+      }
+
+      void log (const std::string &, cxxlog::Severity, std::chrono::milliseconds) const {
+        // empty
+      }
+
+    private:
+      std::shared_ptr<int> _token;
+  };
+}
+
+// ----------------------------------------------------------------------------
+// test_metrics_counters
+// ----------------------------------------------------------------------------
+TEST (Metrics, test_metrics_counters) {
+  std::stringstream ss {};
+  const cxxlog::Logger<cxxlog::transport::OutputStream, Discard> logger { cxxlog::Severity::kDebug };
+  logger.transport (cxxlog::transport::OutputStream { ss });
+
+  const cxxlog::Metrics metrics {};
+  logger.metrics (metrics);
+  logger.transport (Discard {});
+
+  logger.info ("hello {}", 1);
+  logger.error ("world");
+  logger.verbose ("filtered");
+
+  std::thread { [ &logger ] () { logger.info ("thread"); } }.join();
+
+  const auto snapshot { metrics.snapshot() };
+  EXPECT_EQ (snapshot.messages[static_cast<std::size_t> (cxxlog::Severity::kInfo)], 2u);
+  EXPECT_EQ (snapshot.messages[static_cast<std::size_t> (cxxlog::Severity::kError)], 1u);
+  EXPECT_EQ (snapshot.messages[static_cast<std::size_t> (cxxlog::Severity::kVerbose)], 0u);
+
+  ASSERT_EQ (snapshot.transports.size(), 2u);
+  EXPECT_EQ (snapshot.transports[0].calls, 3u);
+  EXPECT_EQ (snapshot.transports[1].calls, 3u);
+
+  // the stream got the whole lines, the discarding transport only the messages
+  EXPECT_EQ (snapshot.transports[0].bytes, ss.str().size());
+  EXPECT_EQ (snapshot.transports[1].bytes, std::string { "hello 1worldthread" }.size());
+  EXPECT_GT (snapshot.transports[0].time.count(), 0);
+  EXPECT_EQ (snapshot.dropped(), 0u);
+
+  // Severity::kNone messages are passed on but not counted per level
+  const cxxlog::Logger<Discard> plain { cxxlog::Severity::kDebug };
+  plain.metrics (metrics);
+  plain.transport (Discard {});
+  plain.log (cxxlog::Severity::kNone, "none");
+
+  const auto after { metrics.snapshot() };
+  EXPECT_EQ (after.transports[0].calls, 4u);
+  EXPECT_EQ (after.messages, snapshot.messages);
+}
+
+// ----------------------------------------------------------------------------
+// test_metrics_alternating
+// ----------------------------------------------------------------------------
+TEST (Metrics, test_metrics_alternating) {
+  // more loggers than the per-thread cache holds, used in turn by the same threads
+  constexpr std::size_t kLoggers { 10 };
+  std::vector<cxxlog::Metrics> metrics (kLoggers);
+  std::vector<cxxlog::Logger<Discard>> loggers (kLoggers);
+  for (std::size_t i = 0; i < kLoggers; ++i) {
+    loggers[i].metrics (metrics[i]);
+    loggers[i].transport (Discard {});
+  }
+
+  const auto work { [ &loggers ] () {
+    for (int n = 0; n < 100; ++n) {
+      for (std::size_t i = 0; i < 2; ++i)
+        loggers[i].info ("two loggers");
+      for (auto &logger: loggers)
+        logger.warn ("all loggers");
+    }
+  } };
+
+  std::thread other { work };
+  work();
+  other.join();
+
+  for (std::size_t i = 0; i < kLoggers; ++i) {
+    const auto snapshot { metrics[i].snapshot() };
+    EXPECT_EQ (snapshot.messages[static_cast<std::size_t> (cxxlog::Severity::kInfo)], i < 2 ? 200u : 0u);
+    EXPECT_EQ (snapshot.messages[static_cast<std::size_t> (cxxlog::Severity::kWarn)], 200u);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// test_metrics_queue
+// ----------------------------------------------------------------------------
+TEST (Metrics, test_metrics_queue) {
+  using Queue = cxxlog::transport::Async<Discard>;
+
+  const cxxlog::Metrics metrics {};
+  const cxxlog::Logger<Queue> logger { cxxlog::Severity::kInfo };
+  logger.metrics (metrics);
+  logger.transport (Queue { Discard {}, 2, cxxlog::transport::Backpressure::kDropNewest });
+
+  for (int i = 0; i < 1000; ++i)
+    logger.info ("message {}", i);
+  logger.flush();
+
+  const auto snapshot { metrics.snapshot() };
+  ASSERT_EQ (snapshot.transports.size(), 1u);
+  EXPECT_EQ (snapshot.transports[0].calls, 1000u);
+  EXPECT_GE (snapshot.transports[0].highWater, 1u);
+  EXPECT_LE (snapshot.transports[0].highWater, 2u);
+  EXPECT_EQ (snapshot.dropped(), snapshot.transports[0].dropped);
+}
+
+// ----------------------------------------------------------------------------
+// test_metrics_queue_lifetime
+// ----------------------------------------------------------------------------
+TEST (Metrics, test_metrics_queue_lifetime) {
+  using Queue = cxxlog::transport::Async<Token>;
+
+  const auto token { std::make_shared<int> (0) };
+  const cxxlog::Metrics metrics {};
+
+  {
+    const cxxlog::Logger<Queue> logger { cxxlog::Severity::kInfo };
+    logger.metrics (metrics);
+    logger.transport (Queue { Token { token } });
+    logger.info ("message");
+    EXPECT_EQ (token.use_count(), 2);
+  }
+
+  // the metrics don't keep the queue and its thread alive
+  EXPECT_EQ (token.use_count(), 1);
+  const auto snapshot { metrics.snapshot() };
+  ASSERT_EQ (snapshot.transports.size(), 1u);
+  EXPECT_EQ (snapshot.transports[0].calls, 1u);
+  EXPECT_EQ (snapshot.transports[0].highWater, 0u);
+}
+
+// ----------------------------------------------------------------------------
+// test_metrics_latency_histogram
+// ----------------------------------------------------------------------------
+TEST (Metrics, test_metrics_latency_histogram) {
+  using Histogram = cxxlog::Metrics::Histogram;
+
+  EXPECT_EQ (Histogram::bucket (0), 0u);
+  EXPECT_EQ (Histogram::bucket (7), 7u);
+  EXPECT_EQ (Histogram::bucket (8), 8u);
+  EXPECT_EQ (Histogram::bucket (15), 15u);
+  EXPECT_EQ (Histogram::bucket (16), 16u);
+  EXPECT_EQ (Histogram::bucket (17), 16u);
+  EXPECT_EQ (Histogram::bucket (~std::uint64_t { 0 }), Histogram::kBuckets - 1);
+
+  // every duration falls within the bounds of its bucket, which are at most 12.5% apart
+  for (std::uint64_t ns = 1; ns < (std::uint64_t { 1 } << 40); ns = ns * 3 + 1) {
+    const auto b { Histogram::bucket (ns) };
+    EXPECT_LE (Histogram::lower (b).count(), static_cast<std::int64_t> (ns));
+    EXPECT_GE (Histogram::upper (b).count(), static_cast<std::int64_t> (ns));
+    EXPECT_LE (static_cast<double> (Histogram::upper (b).count() - Histogram::lower (b).count()), 0.125 * static_cast<double> (Histogram::lower (b).count()));
+  }
+
+  Histogram h {};
+  EXPECT_EQ (h.percentile (50).count(), 0);
+  h.add (Histogram::bucket (100), 90);
+  h.add (Histogram::bucket (10000), 10);
+  EXPECT_EQ (h.count(), 100u);
+  EXPECT_EQ (h.percentile (50), Histogram::upper (Histogram::bucket (100)));
+  EXPECT_EQ (h.percentile (90), Histogram::upper (Histogram::bucket (100)));
+  EXPECT_EQ (h.percentile (99), Histogram::upper (Histogram::bucket (10000)));
+
+  // the logger times every transport call
+  std::stringstream ss {};
+  const cxxlog::Metrics metrics {};
+  const cxxlog::Logger<cxxlog::transport::OutputStream> logger {};
+  logger.transport (cxxlog::transport::OutputStream { ss });
+  logger.metrics (metrics);
+
+  for (int i = 0; i < 100; ++i)
+    logger.info ("message {}", i);
+
+  const auto snapshot { metrics.snapshot() };
+  ASSERT_EQ (snapshot.transports.size(), 1u);
+  EXPECT_EQ (snapshot.transports[0].latency.count(), 100u);
+  EXPECT_LE (snapshot.transports[0].latency.percentile (50), snapshot.transports[0].latency.percentile (100));
+}
@@ -0,0 +1,240 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <atomic>
+#include <cerrno>
+#include <cinttypes>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/transport/mmap.h>
+
+#include "test_helpers.h"
+
+
+// ----------------------------------------------------------------------------
+// Helpers
+// ----------------------------------------------------------------------------
+namespace {
+  // the segments the interposed fallocate() fails for, from this offset on, and its errno
+  std::atomic<off_t> fallocateFailFrom { -1 };
+  std::atomic<int> fallocateErrno { 0 };
+}
+
+// Interposes the fallocate() of the C library, which only MappedFile calls, to fail on demand
+// the way a full filesystem or one without preallocation does.
+extern "C" int fallocate (int fd, int mode, off_t offset, off_t len) {
+  const auto from { fallocateFailFrom.load() };
+  if (from >= 0 && offset >= from) {
+    errno = fallocateErrno.load();
+    return -1;
+  }
+
+  return static_cast<int> (::syscall (SYS_fallocate, fd, mode, offset, len));
+}
+
+
+// ----------------------------------------------------------------------------
+// test_message_with_severity
+// ----------------------------------------------------------------------------
+TEST (MappedFile, test_message_with_severity) {
+  const auto path { tempFile ("test_mmap_message_with_severity.log") };
+
+  {
+    cxxlog::transport::MappedFile mappedFile { path };
+    mappedFile.log ("Test message", cxxlog::Severity::kInfo, std::chrono::milliseconds { 1234567890 });
+    mappedFile.log ("", cxxlog::Severity::kDebug, std::chrono::milliseconds { 1234567890 });
+  }
+
+  EXPECT_EQ (readFile (path), "1970-01-15T06:56:07 I: Test message\n1970-01-15T06:56:07 D: \n");
+}
+
+// ----------------------------------------------------------------------------
+// test_segment_boundaries
+// ----------------------------------------------------------------------------
+TEST (MappedFile, test_segment_boundaries) {
+  const auto path { tempFile ("test_mmap_segment_boundaries.log") };
+
+  std::ostringstream expected {};
+  {
+    const cxxlog::Logger<cxxlog::transport::MappedFile> logger { cxxlog::Severity::kVerbose };
+    logger.transport (cxxlog::transport::MappedFile { path, 1 });
+
+    for (int i = 0; i < 1000; ++i) {
+      const std::string msg (static_cast<std::size_t> (i % 97), static_cast<char> ('a' + i % 26));
+      logger.info ("{} {}", i, msg);
+      expected << " I: " << i << " " << msg << "\n";
+    }
+  }
+
+  std::istringstream lines { readFile (path) };
+  std::ostringstream actual {};
+  for (std::string line; std::getline (lines, line);)
+    actual << line.substr (19) << "\n";
+
+  EXPECT_EQ (actual.str(), expected.str());
+}
+
+// ----------------------------------------------------------------------------
+// test_append_existing_file
+// ----------------------------------------------------------------------------
+TEST (MappedFile, test_append_existing_file) {
+  const auto path { tempFile ("test_mmap_append_existing_file.log") };
+
+  std::ofstream { path } << "previous line\n";
+
+  {
+    cxxlog::transport::MappedFile mappedFile { path, 4096 };
+    mappedFile.log ("next line", cxxlog::Severity::kWarn, std::chrono::milliseconds { 987654321000 });
+  }
+
+  EXPECT_EQ (readFile (path), "previous line\n2001-04-19T04:25:21 W: next line\n");
+}
+
+// ----------------------------------------------------------------------------
+// test_multiple_threads
+// ----------------------------------------------------------------------------
+TEST (MappedFile, test_multiple_threads) {
+  const auto path { tempFile ("test_mmap_multiple_threads.log") };
+  constexpr int kThreads { 4 };
+  constexpr int kLines { 5000 };
+
+  {
+    const cxxlog::Logger<cxxlog::transport::MappedFile> logger { cxxlog::Severity::kVerbose };
+    logger.transport (cxxlog::transport::MappedFile { path, 4096 });
+
+    std::vector<std::thread> threads {};
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back ([ &logger, t ] () {
+        for (int i = 0; i < kLines; ++i)
+          logger.error ("thread {} line {}", t, i);
+      });
+    }
+
+    for (auto &thread: threads)
+      thread.join();
+  }
+
+  std::vector<int> next (kThreads, 0);
+  std::istringstream lines { readFile (path) };
+  for (std::string line; std::getline (lines, line);) {
+    int t { 0 };
+    int i { 0 };
+    ASSERT_EQ (std::sscanf (line.c_str() + 19, " E: thread %d line %d", &t, &i), 2) << line;
+    ASSERT_EQ (i, next[t]++);
+  }
+
+  for (const auto n: next)
+    EXPECT_EQ (n, kLines);
+}
+
+// ----------------------------------------------------------------------------
+// test_segment_failure
+// ----------------------------------------------------------------------------
+TEST (MappedFile, test_segment_failure) {
+  const auto path { tempFile ("test_mmap_segment_failure.log") };
+  const auto page { static_cast<std::size_t> (::sysconf (_SC_PAGESIZE)) };
+  const std::string line (99, 'x');
+
+  // the file can't grow past its first segment: the later ones fail with EFBIG
+  const auto previous { std::signal (SIGXFSZ, SIG_IGN) };
+  struct rlimit saved {};
+  ::getrlimit (RLIMIT_FSIZE, &saved);
+  struct rlimit limit { saved };
+  limit.rlim_cur = page;
+  ASSERT_EQ (::setrlimit (RLIMIT_FSIZE, &limit), 0);
+
+  // "1970-01-01T00:00:00 I: " + line + "\n"
+  const auto lineSize { 23 + line.size() + 1 };
+  std::size_t written { 0 };
+  {
+    const cxxlog::transport::MappedFile mappedFile { path, page };
+
+    // more than kSlots segments: writers of the later segments must not wait for the failed ones
+    for (; written < 10 * page; written += lineSize)
+      mappedFile.log (line, cxxlog::Severity::kInfo, std::chrono::milliseconds { 0 });
+
+    ::setrlimit (RLIMIT_FSIZE, &saved);
+  }
+
+  std::signal (SIGXFSZ, previous);
+
+  // the lines of the first segment are kept and the dropped ranges hold no NULs
+  const auto text { readFile (path) };
+  EXPECT_EQ (text.size(), written);
+  EXPECT_EQ (text.find ('\0'), std::string::npos);
+  EXPECT_EQ (text.substr (23, line.size()), line);
+  EXPECT_EQ (text.substr (5 * page, 8), std::string (8, ' '));
+}
+
+// ----------------------------------------------------------------------------
+// test_segment_no_space
+// ----------------------------------------------------------------------------
+TEST (MappedFile, test_segment_no_space) {
+  const auto path { tempFile ("test_mmap_segment_no_space.log") };
+  const auto page { static_cast<std::size_t> (::sysconf (_SC_PAGESIZE)) };
+  const std::string line (99, 'x');
+
+  // the filesystem is full from the second segment on: the segments must be dropped, not left
+  // sparse, where a write would raise SIGBUS on a real full filesystem
+  fallocateErrno = ENOSPC;
+  fallocateFailFrom = static_cast<off_t> (page);
+
+  const auto lineSize { 23 + line.size() + 1 };
+  std::size_t written { 0 };
+  {
+    const cxxlog::transport::MappedFile mappedFile { path, page };
+    for (; written < 4 * page; written += lineSize)
+      mappedFile.log (line, cxxlog::Severity::kInfo, std::chrono::milliseconds { 0 });
+
+    fallocateFailFrom = -1;
+  }
+
+  const auto text { readFile (path) };
+  EXPECT_EQ (text.size(), written);
+  EXPECT_EQ (text.find ('\0'), std::string::npos);
+  EXPECT_EQ (text.substr (23, line.size()), line);
+  EXPECT_EQ (text.substr (2 * page, 8), std::string (8, ' '));
+}
+
+// ----------------------------------------------------------------------------
+// test_segment_no_preallocation
+// ----------------------------------------------------------------------------
+TEST (MappedFile, test_segment_no_preallocation) {
+  const auto path { tempFile ("test_mmap_segment_no_preallocation.log") };
+  const auto page { static_cast<std::size_t> (::sysconf (_SC_PAGESIZE)) };
+
+  // a filesystem without fallocate() support gets a sparse file instead
+  fallocateErrno = EOPNOTSUPP;
+  fallocateFailFrom = 0;
+
+  const std::string line (99, 'x');
+  const auto lineSize { 23 + line.size() + 1 };
+  std::size_t written { 0 };
+  {
+    const cxxlog::transport::MappedFile mappedFile { path, page };
+    for (; written < 3 * page; written += lineSize)
+      mappedFile.log (line, cxxlog::Severity::kInfo, std::chrono::milliseconds { 0 });
+
+    fallocateFailFrom = -1;
+  }
+
+  // every line is kept
+  const auto text { readFile (path) };
+  EXPECT_EQ (text.size(), written);
+  EXPECT_EQ (text.find ('\0'), std::string::npos);
+  EXPECT_EQ (text.find ("        "), std::string::npos);
+}
@@ -0,0 +1,63 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/modules.h>
+#include <cxxlog/transport.h>
+
+
+namespace {
+  enum class Module { kNet, kDb, kCount };
+}
+
+// ----------------------------------------------------------------------------
+// test_modules_levels
+// ----------------------------------------------------------------------------
+TEST (ModuleLogger, test_modules_levels) {
+  std::stringstream ss {};
+  const cxxlog::ModuleLogger<Module, cxxlog::transport::OutputStream> logger { cxxlog::Severity::kWarn };
+  logger.transport (cxxlog::transport::OutputStream { ss });
+
+  EXPECT_EQ (logger.getLevel (Module::kNet), cxxlog::Severity::kWarn);
+  EXPECT_EQ (logger.setLevel (Module::kNet, cxxlog::Severity::kDebug), cxxlog::Severity::kWarn);
+  EXPECT_TRUE (logger.isEnabled (Module::kNet, cxxlog::Severity::kDebug));
+  EXPECT_FALSE (logger.isEnabled (Module::kDb, cxxlog::Severity::kDebug));
+
+  logger.debug (Module::kNet, "net {}", 1);
+  logger.debug (Module::kDb, "db {}", 1);
+  logger.error (Module::kDb, "db {}", 2);
+
+  auto out { ss.str() };
+  EXPECT_NE (out.find ("net 1"), std::string::npos);
+  EXPECT_EQ (out.find ("db 1"), std::string::npos);
+  EXPECT_NE (out.find ("db 2"), std::string::npos);
+
+  logger.setLevel (cxxlog::Severity::kNone);
+  EXPECT_EQ (logger.getLevel (Module::kNet), cxxlog::Severity::kNone);
+
+  logger.fatal (Module::kNet, "net {}", 2);
+  EXPECT_EQ (ss.str().find ("net 2"), std::string::npos);
+}
+
+// ----------------------------------------------------------------------------
+// test_modules_runtime
+// ----------------------------------------------------------------------------
+TEST (ModuleLogger, test_modules_runtime) {
+  std::stringstream ss {};
+  const cxxlog::ModuleLogger<Module, cxxlog::transport::OutputStream> logger { cxxlog::Severity::kError };
+  logger.transport (cxxlog::transport::OutputStream { ss });
+
+  // a copy shares the levels, so another thread can change them while the logger is used
+  std::thread operator_thread { [ copy = logger ] () { copy.setLevel (Module::kDb, cxxlog::Severity::kInfo); } };
+  operator_thread.join();
+
+  logger.info (Module::kDb, "query");
+  EXPECT_NE (ss.str().find ("query"), std::string::npos);
+}
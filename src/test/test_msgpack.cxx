@@ -0,0 +1,118 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <cinttypes>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/logger.h>
+#include <cxxlog/transport/msgpack.h>
+
+
+// ----------------------------------------------------------------------------
+// test_msgpack_encoding
+// ----------------------------------------------------------------------------
+TEST (MsgPackStream, test_msgpack_encoding) {
+  std::stringstream ss {};
+  cxxlog::transport::MsgPackStream msgPackStream { ss };
+
+  msgPackStream.log ("hi", cxxlog::Severity::kWarn, std::chrono::milliseconds { 1000 });
+
+  EXPECT_EQ (
+    ss.str(),
+    std::string ("\x84\xA2ts\xCD\x03\xE8\xA3sev\x03\xA3msg\xA2hi\xA6" "fields\x80", 27)
+  );
+}
+
+// ----------------------------------------------------------------------------
+// test_msgpack_round_trip
+// ----------------------------------------------------------------------------
+TEST (MsgPackStream, test_msgpack_round_trip) {
+  std::stringstream ss {};
+
+  const cxxlog::Logger<cxxlog::transport::MsgPackStream> logger { cxxlog::Severity::kVerbose };
+  logger.transport (cxxlog::transport::MsgPackStream { ss });
+
+  const std::vector<std::int64_t> ints { 0, 1, 127, -1, -32, -33, -128, -129, -32768, -32769, -2147483648LL, -2147483649LL, std::numeric_limits<std::int64_t>::min() };
+  const std::vector<std::uint64_t> uints { 128, 255, 256, 65535, 65536, 4294967295ULL, 4294967296ULL, std::numeric_limits<std::uint64_t>::max() };
+  const std::vector<std::size_t> sizes { 0, 31, 32, 255, 256, 65535, 65536 };
+
+  for (const auto i: ints)
+    logger.debug ("int {}", i, cxxlog::kv ("v", i));
+  for (const auto u: uints)
+    logger.info ("uint {}", u, cxxlog::kv ("v", u));
+  for (const auto n: sizes)
+    logger.error ("{}", std::string (n, 'm'), cxxlog::kv ("v", std::string (n, 's')));
+  logger.fatal ("mixed", cxxlog::kv ("b", true), cxxlog::kv ("d", -2.5), cxxlog::kv ("e", ""), cxxlog::kv ("f", false));
+
+  const auto data { ss.str() };
+  std::string_view in { data };
+
+  const auto next { [ &in ] () {
+    auto record { cxxlog::transport::MsgPackStream::decode (in) };
+    EXPECT_TRUE (record.has_value());
+    return record.value_or (cxxlog::Record { "", cxxlog::Severity::kNone, {} });
+  } };
+
+  for (const auto i: ints) {
+    const auto record { next() };
+    EXPECT_EQ (record.severity(), cxxlog::Severity::kDebug);
+    EXPECT_EQ (record.message(), cxxlog::fmtlib::format ("int {}", i));
+    ASSERT_EQ (record.fields().size(), 1u);
+    EXPECT_EQ (record.fields()[0].key, "v");
+    EXPECT_EQ (record.fields()[0].value, cxxlog::FieldValue { i >= 0 ? cxxlog::FieldValue { static_cast<std::uint64_t> (i) } : cxxlog::FieldValue { i } });
+  }
+
+  for (const auto u: uints) {
+    const auto record { next() };
+    EXPECT_EQ (record.message(), cxxlog::fmtlib::format ("uint {}", u));
+    ASSERT_EQ (record.fields().size(), 1u);
+    EXPECT_EQ (record.fields()[0].value, cxxlog::FieldValue { u });
+  }
+
+  for (const auto n: sizes) {
+    const auto record { next() };
+    EXPECT_EQ (record.message(), std::string (n, 'm'));
+    ASSERT_EQ (record.fields().size(), 1u);
+    EXPECT_EQ (record.fields()[0].value, cxxlog::FieldValue { std::string (n, 's') });
+  }
+
+  const auto record { next() };
+  EXPECT_EQ (record.severity(), cxxlog::Severity::kFatal);
+  ASSERT_EQ (record.fields().size(), 4u);
+  EXPECT_EQ (record.fields()[0].value, cxxlog::FieldValue { true });
+  EXPECT_EQ (record.fields()[1].value, cxxlog::FieldValue { -2.5 });
+  EXPECT_EQ (record.fields()[2].value, cxxlog::FieldValue { std::string {} });
+  EXPECT_EQ (record.fields()[3].value, cxxlog::FieldValue { false });
+  EXPECT_GT (record.timestamp().count(), 0);
+
+  EXPECT_TRUE (in.empty());
+}
+
+// ----------------------------------------------------------------------------
+// test_msgpack_truncated
+// ----------------------------------------------------------------------------
+TEST (MsgPackStream, test_msgpack_truncated) {
+  std::string data {};
+  cxxlog::transport::MsgPackStream::encode (data, cxxlog::Record { "message", cxxlog::Severity::kInfo, std::chrono::milliseconds { 42 }, { cxxlog::kv ("k", 1.5) } });
+
+  // every prefix of the record is rejected and left untouched
+  for (std::size_t n = 0; n < data.size(); ++n) {
+    std::string_view in { data.data(), n };
+    EXPECT_FALSE (cxxlog::transport::MsgPackStream::decode (in).has_value()) << n;
+    EXPECT_EQ (in.size(), n);
+  }
+
+  std::string_view in { data };
+  const auto record { cxxlog::transport::MsgPackStream::decode (in) };
+  ASSERT_TRUE (record.has_value());
+  EXPECT_EQ (record->timestamp().count(), 42);
+  EXPECT_EQ (record->message(), "message");
+  EXPECT_TRUE (in.empty());
+}
@@ -0,0 +1,104 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/registry.h>
+#include <cxxlog/transport.h>
+
+
+// ----------------------------------------------------------------------------
+// test_registry_inherit
+// ----------------------------------------------------------------------------
+TEST (Registry, test_registry_inherit) {
+  const cxxlog::Registry<cxxlog::transport::OutputStream> registry { cxxlog::Severity::kWarn };
+
+  const auto client { registry.get ("net.http.client") };
+  EXPECT_EQ (client.name(), "net.http.client");
+  EXPECT_EQ (client.getLevel(), cxxlog::Severity::kWarn);
+
+  registry.setLevel ("net", cxxlog::Severity::kDebug);
+  EXPECT_EQ (client.getLevel(), cxxlog::Severity::kDebug);
+  EXPECT_EQ (registry.getLevel ("net.http"), cxxlog::Severity::kDebug);
+  EXPECT_EQ (registry.getLevel ("db"), cxxlog::Severity::kWarn);
+
+  // an explicit level is kept when an ancestor changes
+  registry.setLevel ("net.http.client", cxxlog::Severity::kError);
+  registry.setLevel ("net", cxxlog::Severity::kVerbose);
+  EXPECT_EQ (client.getLevel(), cxxlog::Severity::kError);
+  EXPECT_EQ (registry.getLevel ("net.http"), cxxlog::Severity::kVerbose);
+
+  registry.resetLevel ("net.http.client");
+  EXPECT_EQ (client.getLevel(), cxxlog::Severity::kVerbose);
+
+  registry.resetLevel ("net");
+  EXPECT_EQ (client.getLevel(), cxxlog::Severity::kWarn);
+
+  // the root keeps its level
+  registry.resetLevel ("");
+  EXPECT_EQ (registry.getLevel (""), cxxlog::Severity::kWarn);
+
+  // loggers created later inherit the current level
+  registry.setLevel ("", cxxlog::Severity::kInfo);
+  EXPECT_EQ (registry.getLevel ("net.tcp"), cxxlog::Severity::kInfo);
+}
+
+// ----------------------------------------------------------------------------
+// test_registry_handles
+// ----------------------------------------------------------------------------
+TEST (Registry, test_registry_handles) {
+  std::stringstream ss {};
+  const cxxlog::Registry<cxxlog::transport::OutputStream> registry { cxxlog::Severity::kInfo };
+  registry.transport (cxxlog::transport::OutputStream { ss });
+
+  const auto db { registry.get ("db") };
+  const auto net { registry.get ("net") };
+  EXPECT_EQ (registry.get ("db").name().data(), db.name().data());
+
+  registry.setLevel ("db", cxxlog::Severity::kError);
+  EXPECT_FALSE (db.isEnabled (cxxlog::Severity::kWarn));
+  EXPECT_TRUE (net.isEnabled (cxxlog::Severity::kInfo));
+
+  db.warn ("db {}", 1);
+  db.error ("db {}", 2);
+  net.debug ("net {}", 1);
+  net.info ("net {}", 2);
+
+  const auto out { ss.str() };
+  EXPECT_EQ (out.find ("db 1"), std::string::npos);
+  EXPECT_NE (out.find ("db 2"), std::string::npos);
+  EXPECT_EQ (out.find ("net 1"), std::string::npos);
+  EXPECT_NE (out.find ("net 2"), std::string::npos);
+}
+
+// ----------------------------------------------------------------------------
+// test_registry_threads
+// ----------------------------------------------------------------------------
+TEST (Registry, test_registry_threads) {
+  const cxxlog::Registry<cxxlog::transport::OutputStream> registry {};
+
+  std::vector<std::thread> threads {};
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back ([ &registry, i ] () {
+      for (int j = 0; j < 100; ++j) {
+        const auto handle { registry.get ("a.b" + std::to_string (j % 10)) };
+        registry.setLevel ("a", (i % 2) ? cxxlog::Severity::kDebug : cxxlog::Severity::kError);
+        EXPECT_EQ (handle.name().substr (0, 3), "a.b");
+        (void) handle.isEnabled (cxxlog::Severity::kInfo);
+      }
+    });
+  }
+
+  for (auto &t: threads)
+    t.join();
+
+  registry.setLevel ("a", cxxlog::Severity::kFatal);
+  EXPECT_EQ (registry.getLevel ("a.b7"), cxxlog::Severity::kFatal);
+}
@@ -0,0 +1,142 @@
+// ----------------------------------------------------------------------------
+// MIT License
+//
+// Copyright (c) 2023 Carlos Carrasco
+// ----------------------------------------------------------------------------
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cxxlog/throttle.h>
+#include <cxxlog/transport.h>
+#include <cxxlog/transport/backtrace.h>
+
+
+namespace {
+  std::size_t count (const std::string &text, const std::string &what) {
+    std::size_t n { 0 };
+    for (auto pos = text.find (what); pos != std::string::npos; pos = text.find (what, pos + 1))
+      ++n;
+
+    return n;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// test_throttle_every_n
+// ----------------------------------------------------------------------------
+TEST (Throttle, test_throttle_every_n) {
+  cxxlog::EveryN every { 3 };
+  std::vector<bool> allowed {};
+  for (int i = 0; i < 7; ++i)
+    allowed.push_back (every.allow());
+
+  EXPECT_EQ (allowed, (std::vector<bool> { true, false, false, true, false, false, true }));
+
+  cxxlog::EveryN all { 0 };
+  EXPECT_TRUE (all.allow());
+  EXPECT_TRUE (all.allow());
+
+  cxxlog::Once once {};
+  EXPECT_TRUE (once.allow());
+  EXPECT_FALSE (once.allow());
+}
+
+// ----------------------------------------------------------------------------
+// test_throttle_rate
+// ----------------------------------------------------------------------------
+TEST (Throttle, test_throttle_rate) {
+  cxxlog::RateLimit rate { 2 };
+
+  EXPECT_TRUE (rate.allow (100));
+  EXPECT_TRUE (rate.allow (100));
+  EXPECT_FALSE (rate.allow (100));
+  EXPECT_FALSE (rate.allow (100));
+
+  EXPECT_TRUE (rate.allow (101));
+  EXPECT_TRUE (rate.allow (101));
+  EXPECT_FALSE (rate.allow (101));
+
+  // a call which read the clock before the window changed is dropped
+  EXPECT_FALSE (rate.allow (100));
+
+  EXPECT_TRUE (rate.allow (105));
+
+  cxxlog::RateLimit none { 0 };
+  EXPECT_FALSE (none.allow (1));
+  EXPECT_FALSE (none.allow (2));
+}
+
+// ----------------------------------------------------------------------------
+// test_throttle_threads
+// ----------------------------------------------------------------------------
+TEST (Throttle, test_throttle_threads) {
+  cxxlog::RateLimit rate { 100 };
+  cxxlog::EveryN every { 10 };
+  cxxlog::Once once {};
+  std::atomic<int> rated { 0 }, everied { 0 }, onced { 0 };
+
+  std::vector<std::thread> threads {};
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back ([ & ] () {
+      for (int j = 0; j < 1000; ++j) {
+        rated += rate.allow (7) ? 1 : 0;
+        everied += every.allow() ? 1 : 0;
+        onced += once.allow() ? 1 : 0;
+      }
+    });
+  }
+
+  for (auto &t: threads)
+    t.join();
+
+  EXPECT_EQ (rated.load(), 100);
+  EXPECT_EQ (everied.load(), 400);
+  EXPECT_EQ (onced.load(), 1);
+}
+
+// ----------------------------------------------------------------------------
+// test_throttle_macros
+// ----------------------------------------------------------------------------
+TEST (Throttle, test_throttle_macros) {
+  std::stringstream ss {};
+  const cxxlog::Logger<cxxlog::transport::OutputStream> logger { cxxlog::Severity::kInfo };
+  logger.transport (cxxlog::transport::OutputStream { ss });
+
+  for (int i = 0; i < 10; ++i) {
+    CXXLOG_LOG_EVERY_N (logger, cxxlog::Severity::kError, 4, "every {}", i);
+    CXXLOG_LOG_ONCE (logger, cxxlog::Severity::kWarn, "once {}", i);
+    CXXLOG_LOG_RATE (logger, cxxlog::Severity::kError, 1000, "rate {}", i);
+    CXXLOG_LOG_ONCE (logger, cxxlog::Severity::kDebug, "disabled");
+  }
+
+  const auto out { ss.str() };
+  EXPECT_EQ (count (out, "every "), 3u);
+  EXPECT_NE (out.find ("every 8"), std::string::npos);
+  EXPECT_EQ (count (out, "once "), 1u);
+  EXPECT_NE (out.find ("once 0"), std::string::npos);
+  EXPECT_EQ (count (out, "rate "), 10u);
+  EXPECT_EQ (out.find ("disabled"), std::string::npos);
+}
+
+// ----------------------------------------------------------------------------
+// test_throttle_capturing
+// ----------------------------------------------------------------------------
+TEST (Throttle, test_throttle_capturing) {
+  using Wrapper = cxxlog::transport::Backtrace<cxxlog::transport::OutputStream>;
+
+  std::stringstream ss {};
+  const cxxlog::Logger<Wrapper> logger { cxxlog::Severity::kWarn };
+  logger.transport (Wrapper { cxxlog::transport::OutputStream { ss }, 8 });
+
+  // the disabled calls are still captured and come out with the error
+  CXXLOG_LOG_ONCE (logger, cxxlog::Severity::kDebug, "disabled {}", 1);
+  EXPECT_TRUE (ss.str().empty());
+
+  logger.error ("failed");
+  EXPECT_NE (ss.str().find ("disabled 1"), std::string::npos);
+}
@@ -5,6 +5,7 @@
 // ----------------------------------------------------------------------------
 #include <cinttypes>
 #include <sstream>
+#include <string>
 
 #include <gtest/gtest.h>
 
@@ -60,4 +61,82 @@ TEST_F(OutputStreamTest, test_empty_message) {
   outputStream.log ("", cxxlog::Severity::kDebug, ts);
 
   EXPECT_EQ (stream.str(), "1970-01-15T06:56:07 D: \n");
-}
\ No newline at end of file
+}
+
+// ----------------------------------------------------------------------------
+// test_pattern_layout
+// ----------------------------------------------------------------------------
+TEST (PatternLayout, test_pattern_layout) {
+  using Layout = cxxlog::PatternLayout<"{ts:iso} [{sev}] {thread} {msg}">;
+
+  std::stringstream ss {};
+  cxxlog::transport::BasicOutputStream<Layout> outputStream { ss };
+
+  const cxxlog::Record record { "Test message", cxxlog::Severity::kWarn, std::chrono::milliseconds { 987654321000 } };
+  outputStream.log (record);
+
+  EXPECT_EQ (ss.str(), cxxlog::fmtlib::format ("2001-04-19T04:25:21 [W] {} Test message\n", record.thread()));
+}
+
+// ----------------------------------------------------------------------------
+// test_pattern_layout_fields
+// ----------------------------------------------------------------------------
+TEST (PatternLayout, test_pattern_layout_fields) {
+  using Layout = cxxlog::PatternLayout<"{{{ts:epoch_ms}}} {ts:iso_ms} {sev:name}: <{msg}> {ts}">;
+
+  const cxxlog::Record record { "text", cxxlog::Severity::kError, std::chrono::milliseconds { 987654321042 } };
+
+  std::string scratch {};
+  const auto parts { record.parts<Layout> (scratch) };
+
+  EXPECT_EQ (parts.prefix, "{987654321042} 2001-04-19T04:25:21.042 ERROR: <");
+  EXPECT_EQ (parts.suffix, "> 2001-04-19T04:25:21\n");
+
+  // timestamps before the epoch round down to the previous second
+  const cxxlog::Record early { "text", cxxlog::Severity::kError, std::chrono::milliseconds { -1 } };
+  EXPECT_EQ (early.parts<Layout> (scratch).prefix, "{-1} 1969-12-31T23:59:59.999 ERROR: <");
+  EXPECT_EQ (early.parts<Layout> (scratch).suffix, "> 1969-12-31T23:59:59\n");
+}
+
+// ----------------------------------------------------------------------------
+// test_pattern_layout_matches_default
+// ----------------------------------------------------------------------------
+TEST (PatternLayout, test_pattern_layout_matches_default) {
+  std::stringstream ss0 {};
+  std::stringstream ss1 {};
+
+  const cxxlog::Logger<cxxlog::transport::OutputStream, cxxlog::transport::BasicOutputStream<cxxlog::PatternLayout<"{ts:iso} {sev}: {msg}">>> logger {
+    cxxlog::Severity::kVerbose
+  };
+  logger.transport (cxxlog::transport::OutputStream { ss0 });
+  logger.transport (cxxlog::transport::BasicOutputStream<cxxlog::PatternLayout<"{ts:iso} {sev}: {msg}">> { ss1 });
+
+  logger.info ("Hello {}", "pattern");
+
+  EXPECT_NE (ss0.str().find (" I: Hello pattern\n"), std::string::npos);
+  EXPECT_EQ (ss0.str(), ss1.str());
+}
+
+// ----------------------------------------------------------------------------
+// test_pattern_layout_structured_fields
+// ----------------------------------------------------------------------------
+TEST (PatternLayout, test_pattern_layout_structured_fields) {
+  using Layout = cxxlog::PatternLayout<"{sev:name} {msg} |{fields}">;
+
+  const cxxlog::Record empty { "text", cxxlog::Severity::kInfo, std::chrono::milliseconds { 0 } };
+  const cxxlog::Record record {
+    "text", cxxlog::Severity::kInfo, std::chrono::milliseconds { 0 },
+    { cxxlog::kv ("n", -1), cxxlog::kv ("s", "a=\"b\""), cxxlog::kv ("e", "") }
+  };
+
+  std::string scratch {};
+  EXPECT_EQ (empty.parts<Layout> (scratch).suffix, " |\n");
+  EXPECT_EQ (record.parts<Layout> (scratch).suffix, " | n=-1 s=\"a=\\\"b\\\"\" e=\"\"\n");
+
+  // control characters are escaped, so a value can't break the line
+  const cxxlog::Record control {
+    "text", cxxlog::Severity::kInfo, std::chrono::milliseconds { 0 },
+    { cxxlog::kv ("c", std::string { "a\tb\r\n\x01", 6 }) }
+  };
+  EXPECT_EQ (control.parts<Layout> (scratch).suffix, " | c=\"a\\tb\\r\\n\\u0001\"\n");
+}